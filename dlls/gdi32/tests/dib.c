@@ -3529,11 +3529,39 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+/* run the tests again with the Wine DIB engine splitting large operations across threads */
+static void test_dib_threads(char *argv0)
+{
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    char cmdline[MAX_PATH + 16];
+    BOOL ret;
+
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    sprintf(cmdline, "\"%s\" dib threads", argv0);
+    SetEnvironmentVariableA("WINEDIBTHREADS", "4");
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info);
+    SetEnvironmentVariableA("WINEDIBTHREADS", NULL);
+    ok(ret, "CreateProcess failed, error %lu.\n", GetLastError());
+    if (!ret) return;
+    wait_child_process(info.hProcess);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+}
+
 START_TEST(dib)
 {
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
+
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
     test_simple_graphics();
 
     CryptReleaseContext(crypt_prov, 0);
+
+    if (argc < 3) test_dib_threads(argv[0]);
 }
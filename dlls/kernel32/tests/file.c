@@ -5685,6 +5685,85 @@ static void test_overlapped_read(void)
     ok(ret, "Unexpected error %lu.\n", GetLastError());
 }
 
+static void test_overlapped_queue(void)
+{
+    static const char prefix[] = "pfx";
+    char temp_path[MAX_PATH];
+    char file_name[MAX_PATH];
+    OVERLAPPED ovs[16], *ov;
+    unsigned char *buffer;
+    HANDLE hfile, port;
+    DWORD bytes_count;
+    ULONG_PTR key;
+    unsigned int i, j;
+    DWORD ret;
+
+    ret = GetTempPathA(MAX_PATH, temp_path);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+    ret = GetTempFileNameA(temp_path, prefix, 0, file_name);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+
+    hfile = CreateFileA(file_name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+            FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL);
+    ok(hfile != INVALID_HANDLE_VALUE, "Failed to create file, GetLastError() %lu.\n", GetLastError());
+    port = CreateIoCompletionPort(hfile, NULL, 0xdead, 0);
+    ok(port != NULL, "Failed to create completion port, GetLastError() %lu.\n", GetLastError());
+
+    buffer = VirtualAlloc(NULL, ARRAY_SIZE(ovs) * 0x1000, MEM_COMMIT, PAGE_READWRITE);
+    for (i = 0; i < ARRAY_SIZE(ovs); i++) memset(buffer + i * 0x1000, i + 1, 0x1000);
+
+    /* queue several writes at once */
+    for (i = 0; i < ARRAY_SIZE(ovs); i++)
+    {
+        memset(&ovs[i], 0, sizeof(ovs[i]));
+        S(U(ovs[i])).Offset = i * 0x1000;
+        ret = WriteFile(hfile, buffer + i * 0x1000, 0x1000, NULL, &ovs[i]);
+        /* extending writes may complete synchronously */
+        ok(ret || GetLastError() == ERROR_IO_PENDING,
+                "Unexpected WriteFile result, ret %#lx, GetLastError() %lu.\n", ret, GetLastError());
+    }
+    for (i = 0; i < ARRAY_SIZE(ovs); i++)
+    {
+        ret = GetQueuedCompletionStatus(port, &bytes_count, &key, &ov, 1000);
+        ok(ret, "GetQueuedCompletionStatus failed, GetLastError() %lu.\n", GetLastError());
+        if (!ret) break;
+        ok(key == 0xdead, "Unexpected key %#Ix.\n", key);
+        ok(bytes_count == 0x1000, "Unexpected write size %lu.\n", bytes_count);
+        ok(ov >= ovs && ov < ovs + ARRAY_SIZE(ovs), "Unexpected overlapped %p.\n", ov);
+    }
+
+    /* and read the data back in reverse order */
+    memset(buffer, 0, ARRAY_SIZE(ovs) * 0x1000);
+    for (i = 0; i < ARRAY_SIZE(ovs); i++)
+    {
+        memset(&ovs[i], 0, sizeof(ovs[i]));
+        S(U(ovs[i])).Offset = (ARRAY_SIZE(ovs) - 1 - i) * 0x1000;
+        ret = ReadFile(hfile, buffer + i * 0x1000, 0x1000, NULL, &ovs[i]);
+        ok(ret || GetLastError() == ERROR_IO_PENDING,
+                "Unexpected ReadFile result, ret %#lx, GetLastError() %lu.\n", ret, GetLastError());
+    }
+    for (i = 0; i < ARRAY_SIZE(ovs); i++)
+    {
+        ret = GetQueuedCompletionStatus(port, &bytes_count, &key, &ov, 1000);
+        ok(ret, "GetQueuedCompletionStatus failed, GetLastError() %lu.\n", GetLastError());
+        if (!ret) break;
+        ok(bytes_count == 0x1000, "Unexpected read size %lu.\n", bytes_count);
+    }
+    for (i = 0; i < ARRAY_SIZE(ovs); i++)
+    {
+        ret = GetOverlappedResult(hfile, &ovs[i], &bytes_count, FALSE);
+        ok(ret && bytes_count == 0x1000, "Unexpected result %#lx, bytes_count %lu.\n", ret, bytes_count);
+        for (j = 0; j < 0x1000; j++) if (buffer[i * 0x1000 + j] != ARRAY_SIZE(ovs) - i) break;
+        ok(j == 0x1000, "%u: unexpected data %#x at %#x.\n", i, buffer[i * 0x1000 + j], j);
+    }
+
+    VirtualFree(buffer, 0, MEM_RELEASE);
+    CloseHandle(port);
+    CloseHandle(hfile);
+    ret = DeleteFileA(file_name);
+    ok(ret, "Unexpected error %lu.\n", GetLastError());
+}
+
 static void test_file_readonly_access(void)
 {
     static const DWORD default_sharing = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
@@ -6262,6 +6341,7 @@ START_TEST(file)
     test_GetFileAttributesExW();
     test_post_completion();
     test_overlapped_read();
+    test_overlapped_queue();
     test_file_readonly_access();
     test_find_file_stream();
     test_SetFileTime();
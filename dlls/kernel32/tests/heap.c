@@ -3701,6 +3701,86 @@ static void test_heap_sizes(void)
     test_heap_size( 0x150000 );
 }
 
+struct lfh_thread_params
+{
+    HANDLE heap;
+    void **ptrs;
+    unsigned int count;
+};
+
+static DWORD WINAPI lfh_free_thread( void *arg )
+{
+    struct lfh_thread_params *params = arg;
+    unsigned int i;
+    BOOL ret;
+
+    for (i = 0; i < params->count; i++)
+    {
+        ret = HeapFree( params->heap, 0, params->ptrs[i] );
+        ok( ret, "HeapFree failed, error %lu\n", GetLastError() );
+    }
+    for (i = 0; i < params->count; i++)
+    {
+        params->ptrs[i] = HeapAlloc( params->heap, 0, 8 + (i % 0x10) * 0x10 );
+        ok( !!params->ptrs[i], "HeapAlloc failed, error %lu\n", GetLastError() );
+        memset( params->ptrs[i], 0xcc, 8 + (i % 0x10) * 0x10 );
+    }
+    return 0;
+}
+
+static void test_lfh_threads(void)
+{
+    struct lfh_thread_params params;
+    ULONG compat_info = 2;
+    void *ptrs[0x200];
+    unsigned int i;
+    HANDLE thread;
+    SIZE_T size;
+    BOOL ret;
+
+    if (!pHeapSetInformation)
+    {
+        win_skip( "HeapSetInformation not found, skipping LFH thread tests\n" );
+        return;
+    }
+
+    params.heap = HeapCreate( HEAP_GROWABLE, 0, 0 );
+    ok( !!params.heap, "HeapCreate failed, error %lu\n", GetLastError() );
+    ret = pHeapSetInformation( params.heap, HeapCompatibilityInformation, &compat_info, sizeof(compat_info) );
+    ok( ret, "HeapSetInformation failed, error %lu\n", GetLastError() );
+
+    /* blocks freed and reallocated from another thread must remain consistent */
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++)
+    {
+        ptrs[i] = HeapAlloc( params.heap, 0, 8 + (i % 0x10) * 0x10 );
+        ok( !!ptrs[i], "HeapAlloc failed, error %lu\n", GetLastError() );
+    }
+    params.ptrs = ptrs;
+    params.count = ARRAY_SIZE(ptrs);
+
+    thread = CreateThread( NULL, 0, lfh_free_thread, &params, 0, NULL );
+    ok( !!thread, "CreateThread failed, error %lu\n", GetLastError() );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+
+    ret = HeapValidate( params.heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++)
+    {
+        size = HeapSize( params.heap, 0, ptrs[i] );
+        ok( size == 8 + (i % 0x10) * 0x10, "got size %#Ix\n", size );
+        ret = HeapFree( params.heap, 0, ptrs[i] );
+        ok( ret, "HeapFree failed, error %lu\n", GetLastError() );
+    }
+
+    ret = HeapValidate( params.heap, 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+
+    ret = HeapDestroy( params.heap );
+    ok( ret, "HeapDestroy failed, error %lu\n", GetLastError() );
+}
+
 START_TEST(heap)
 {
     int argc;
@@ -3738,4 +3818,5 @@ START_TEST(heap)
     }
     else win_skip( "RtlGetNtGlobalFlags not found, skipping heap debug tests\n" );
     test_heap_sizes();
+    test_lfh_threads();
 }
@@ -479,6 +479,29 @@ static BOOL is_same_file( HANDLE h1, HANDLE h2 )
 }
 
 
+/***********************************************************************
+ *           copy_file_extents
+ *
+ * Let the file system copy (or share) the whole file data without going through a buffer.
+ */
+static BOOL copy_file_extents( HANDLE h1, HANDLE h2 )
+{
+    FILE_STANDARD_INFORMATION std;
+    DUPLICATE_EXTENTS_DATA data;
+    IO_STATUS_BLOCK io;
+
+    if (NtQueryInformationFile( h1, &io, &std, sizeof(std), FileStandardInformation )) return FALSE;
+    if (!std.EndOfFile.QuadPart) return FALSE;
+
+    data.FileHandle = h1;
+    data.SourceFileOffset.QuadPart = 0;
+    data.TargetFileOffset.QuadPart = 0;
+    data.ByteCount = std.EndOfFile;
+    return !NtFsControlFile( h2, 0, NULL, NULL, &io, FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+                             &data, sizeof(data), NULL, 0 );
+}
+
+
 /******************************************************************************
  *	AreFileApisANSI   (kernelbase.@)
  */
@@ -566,6 +589,12 @@ BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUT
         return FALSE;
     }
 
+    if (copy_file_extents( h1, h2 ))
+    {
+        ret = TRUE;
+        goto done;
+    }
+
     while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
     {
         char *p = buffer;
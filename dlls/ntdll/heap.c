@@ -300,6 +300,7 @@ struct heap
     RTL_CRITICAL_SECTION cs;
     struct entry     free_lists[FREE_LIST_COUNT];
     struct bin      *bins;
+    LONG             id;            /* unique id, to detect stale thread caches */
     SUBHEAP          subheap;
 };
 
@@ -329,8 +330,41 @@ C_ASSERT( HEAP_MIN_LARGE_BLOCK_SIZE <= HEAP_INITIAL_GROW_SIZE );
 #define HEAP_CHECKING_ENABLED 0x80000000
 
 static struct heap *process_heap;  /* main process heap */
+static LONG next_heap_id;
+
+/* per-thread cache of free LFH blocks for the smallest size classes */
+
+#define THREAD_CACHE_BINS    0x10  /* bins with a thread cache, blocks up to 256 bytes */
+#define THREAD_CACHE_DEPTH   8     /* max number of cached blocks per bin */
+#define THREAD_CACHE_HEAPS   4     /* max number of heaps cached per thread */
+
+struct thread_heap_cache
+{
+    struct heap  *heap;            /* heap the blocks belong to */
+    LONG          heap_id;         /* id of the heap, the heap may have been destroyed since */
+    BYTE          count[THREAD_CACHE_BINS];
+    struct block *blocks[THREAD_CACHE_BINS][THREAD_CACHE_DEPTH];
+};
+
+/* stored in the TEB ReservedForPerf field */
+struct thread_heap_caches
+{
+    struct list              entry;  /* entry in the list of the caches of all threads */
+    HANDLE                   tid;    /* id of the owning thread */
+    TEB                     *teb;    /* TEB of the owning thread */
+    struct thread_heap_cache heaps[THREAD_CACHE_HEAPS];
+};
+
+/* the thread is exiting and has flushed its caches */
+#define THREAD_CACHES_DISABLED ((struct thread_heap_caches *)~(ULONG_PTR)0)
+
+/* caches of all threads, protected by the process heap lock */
+static struct list thread_caches_list = LIST_INIT( thread_caches_list );
+static UINT thread_caches_count;
+static UINT thread_caches_check = 16;  /* look for orphaned caches when there are that many */
 
 static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block );
+static void clear_thread_heap_caches( struct heap *heap );
 
 /* check if memory range a contains memory range b */
 static inline BOOL contains( const void *a, SIZE_T a_size, const void *b, SIZE_T b_size )
@@ -1536,6 +1570,7 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, void *addr, SIZE_T total_size, SIZE_T
     heap->flags         = (flags & ~HEAP_SHARED);
     heap->compat_info   = HEAP_STD;
     heap->magic         = HEAP_MAGIC;
+    heap->id            = InterlockedIncrement( &next_heap_id );
     heap->grow_size     = HEAP_INITIAL_GROW_SIZE;
     heap->min_size      = commit_size;
     list_init( &heap->subheap_list );
@@ -1658,6 +1693,7 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE handle )
     /* remove it from the per-process list */
     RtlEnterCriticalSection( &process_heap->cs );
     list_remove( &heap->entry );
+    clear_thread_heap_caches( heap );
     RtlLeaveCriticalSection( &process_heap->cs );
 
     heap->cs.DebugInfo->Spare[0] = 0;
@@ -1927,6 +1963,158 @@ static struct block *find_free_bin_block( struct heap *heap, ULONG flags, SIZE_T
     return block;
 }
 
+/* return an already marked free block to its group */
+static NTSTATUS group_free_block( struct heap *heap, ULONG flags, struct bin *bin, struct block *block )
+{
+    struct group *group = block_get_group( block );
+    SIZE_T i = block_get_group_index( block );
+
+    /* if this was the last used block in a group and GROUP_FLAG_FREE was set */
+    if (InterlockedOr( &group->free_bits, 1 << i ) == ~(1 << i))
+    {
+        /* thread now owns the group, and can release it to its bin */
+        group->free_bits = ~GROUP_FLAG_FREE;
+        return heap_release_bin_group( heap, flags, bin, group );
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* flush the blocks of a thread cache back to their groups */
+static void thread_cache_flush( struct thread_heap_cache *cache, ULONG flags, UINT bin, UINT count )
+{
+    struct heap *heap = cache->heap;
+
+    while (count--) group_free_block( heap, flags, heap->bins + bin, cache->blocks[bin][--cache->count[bin]] );
+}
+
+/* flush all the blocks of a thread's caches; process heap lock must be held */
+static void flush_thread_heap_caches( struct thread_heap_caches *caches )
+{
+    struct thread_heap_cache *cache;
+    UINT i, bin;
+
+    for (i = 0; i < THREAD_CACHE_HEAPS; i++)
+    {
+        cache = caches->heaps + i;
+        if (!cache->heap_id) continue;  /* unused, or its heap was destroyed */
+        for (bin = 0; bin < THREAD_CACHE_BINS; bin++)
+            thread_cache_flush( cache, cache->heap->flags, bin, cache->count[bin] );
+    }
+}
+
+/* forget the blocks cached by all threads for a heap being destroyed; process heap lock must be held */
+static void clear_thread_heap_caches( struct heap *heap )
+{
+    struct thread_heap_caches *caches;
+    UINT i;
+
+    /* ids are unique, so this can't release a slot that the owner just reused for another heap */
+    LIST_FOR_EACH_ENTRY( caches, &thread_caches_list, struct thread_heap_caches, entry )
+        for (i = 0; i < THREAD_CACHE_HEAPS; i++)
+            InterlockedCompareExchange( &caches->heaps[i].heap_id, 0, heap->id );
+}
+
+/* check whether the thread owning some caches is gone without going through heap_thread_detach */
+static BOOL thread_caches_orphaned( const struct thread_heap_caches *caches )
+{
+    THREAD_BASIC_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    CLIENT_ID cid;
+    HANDLE handle;
+    NTSTATUS status;
+
+    cid.UniqueProcess = 0;
+    cid.UniqueThread = caches->tid;
+    InitializeObjectAttributes( &attr, NULL, 0, NULL, NULL );
+    if (NtOpenThread( &handle, THREAD_QUERY_LIMITED_INFORMATION, &attr, &cid )) return TRUE;
+    status = NtQueryInformationThread( handle, ThreadBasicInformation, &info, sizeof(info), NULL );
+    NtClose( handle );
+    if (status) return FALSE;
+    return info.ExitStatus != STATUS_PENDING || info.TebBaseAddress != caches->teb ||
+           info.ClientId.UniqueProcess != NtCurrentTeb()->ClientId.UniqueProcess;
+}
+
+/* flush and free the caches of terminated threads; process heap lock must be held */
+static void reclaim_orphaned_thread_caches(void)
+{
+    struct thread_heap_caches *caches, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( caches, next, &thread_caches_list, struct thread_heap_caches, entry )
+    {
+        if (caches->teb == NtCurrentTeb() || !thread_caches_orphaned( caches )) continue;
+        TRACE( "reclaiming caches of thread %04lx\n", HandleToULong( caches->tid ) );
+        flush_thread_heap_caches( caches );
+        list_remove( &caches->entry );
+        thread_caches_count--;
+        RtlFreeHeap( process_heap, 0, caches );
+    }
+
+    /* check again once the number of caches has doubled, to keep the cost amortized */
+    thread_caches_check = max( 16, 2 * thread_caches_count );
+}
+
+/* get the current thread cache for a heap, creating it if needed */
+static struct thread_heap_cache *get_thread_heap_cache( struct heap *heap, BOOL create )
+{
+    struct thread_heap_caches *caches = NtCurrentTeb()->ReservedForPerf;
+    struct thread_heap_cache *cache, *free = NULL;
+    UINT i;
+
+    if (caches == THREAD_CACHES_DISABLED) return NULL;
+    if (!caches)
+    {
+        if (!create) return NULL;
+        if (!(caches = RtlAllocateHeap( process_heap, HEAP_ZERO_MEMORY, sizeof(*caches) ))) return NULL;
+        caches->tid = NtCurrentTeb()->ClientId.UniqueThread;
+        caches->teb = NtCurrentTeb();
+
+        RtlEnterCriticalSection( &process_heap->cs );
+        list_add_tail( &thread_caches_list, &caches->entry );
+        if (++thread_caches_count >= thread_caches_check) reclaim_orphaned_thread_caches();
+        RtlLeaveCriticalSection( &process_heap->cs );
+
+        NtCurrentTeb()->ReservedForPerf = caches;
+    }
+
+    for (i = 0; i < THREAD_CACHE_HEAPS; i++)
+    {
+        cache = caches->heaps + i;
+        if (cache->heap == heap && cache->heap_id == heap->id) return cache;
+        /* slots of destroyed heaps have their id cleared */
+        if (!free && !cache->heap_id) free = cache;
+    }
+
+    if (!create || !free) return NULL;
+    /* if the heap was destroyed, the cached blocks are gone with it */
+    memset( free->count, 0, sizeof(free->count) );
+    free->heap = heap;
+    free->heap_id = heap->id;
+    return free;
+}
+
+/* get a free block from the current thread cache, the group free bit is already cleared */
+static struct block *thread_cache_get_block( struct heap *heap, UINT bin )
+{
+    struct thread_heap_cache *cache;
+
+    if (bin >= THREAD_CACHE_BINS) return NULL;
+    if (!(cache = get_thread_heap_cache( heap, FALSE )) || !cache->count[bin]) return NULL;
+    return cache->blocks[bin][--cache->count[bin]];
+}
+
+/* put a block marked as free in the current thread cache, flushing half of it when it's full */
+static BOOL thread_cache_put_block( struct heap *heap, ULONG flags, UINT bin, struct block *block )
+{
+    struct thread_heap_cache *cache;
+
+    if (bin >= THREAD_CACHE_BINS) return FALSE;
+    if (!(cache = get_thread_heap_cache( heap, TRUE ))) return FALSE;
+    if (cache->count[bin] == THREAD_CACHE_DEPTH) thread_cache_flush( cache, flags, bin, THREAD_CACHE_DEPTH / 2 );
+    cache->blocks[bin][cache->count[bin]++] = block;
+    return TRUE;
+}
+
 static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T block_size,
                                          SIZE_T size, void **ret )
 {
@@ -1941,7 +2129,8 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
 
     block_size = BLOCK_BIN_SIZE( BLOCK_SIZE_BIN( block_size ) );
 
-    if ((block = find_free_bin_block( heap, flags, block_size, bin )))
+    if ((block = thread_cache_get_block( heap, bin - heap->bins )) ||
+        (block = find_free_bin_block( heap, flags, block_size, bin )))
     {
         block_set_type( block, BLOCK_TYPE_USED );
         block_set_flags( block, ~BLOCK_FLAG_LFH, BLOCK_USER_FLAGS( flags ) );
@@ -1957,30 +2146,20 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
 static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block )
 {
     struct bin *bin, *last = heap->bins + BLOCK_SIZE_BIN_COUNT - 1;
-    SIZE_T i, block_size = block_get_size( block );
-    struct group *group = block_get_group( block );
-    NTSTATUS status = STATUS_SUCCESS;
+    SIZE_T block_size = block_get_size( block );
 
     if (!(block_get_flags( block ) & BLOCK_FLAG_LFH)) return STATUS_UNSUCCESSFUL;
 
     bin = heap->bins + BLOCK_SIZE_BIN( block_size );
     if (bin == last) return STATUS_UNSUCCESSFUL;
 
-    i = block_get_group_index( block );
     valgrind_make_writable( block, sizeof(*block) );
     block_set_type( block, BLOCK_TYPE_FREE );
     block_set_flags( block, ~BLOCK_FLAG_LFH, BLOCK_FLAG_FREE );
     mark_block_free( block + 1, (char *)block + block_size - (char *)(block + 1), flags );
 
-    /* if this was the last used block in a group and GROUP_FLAG_FREE was set */
-    if (InterlockedOr( &group->free_bits, 1 << i ) == ~(1 << i))
-    {
-        /* thread now owns the group, and can release it to its bin */
-        group->free_bits = ~GROUP_FLAG_FREE;
-        status = heap_release_bin_group( heap, flags, bin, group );
-    }
-
-    return status;
+    if (thread_cache_put_block( heap, flags, bin - heap->bins, block )) return STATUS_SUCCESS;
+    return group_free_block( heap, flags, bin, block );
 }
 
 static void bin_try_enable( struct heap *heap, struct bin *bin )
@@ -2029,16 +2208,28 @@ static void heap_thread_detach_bin_groups( struct heap *heap )
 
 void heap_thread_detach(void)
 {
+    struct thread_heap_caches *caches = NtCurrentTeb()->ReservedForPerf;
     struct heap *heap;
 
+    NtCurrentTeb()->ReservedForPerf = THREAD_CACHES_DISABLED;
+
     RtlEnterCriticalSection( &process_heap->cs );
 
+    if (caches && caches != THREAD_CACHES_DISABLED)
+    {
+        flush_thread_heap_caches( caches );
+        list_remove( &caches->entry );
+        thread_caches_count--;
+    }
+
     LIST_FOR_EACH_ENTRY( heap, &process_heap->entry, struct heap, entry )
         heap_thread_detach_bin_groups( heap );
 
     heap_thread_detach_bin_groups( process_heap );
 
     RtlLeaveCriticalSection( &process_heap->cs );
+
+    if (caches && caches != THREAD_CACHES_DISABLED) RtlFreeHeap( process_heap, 0, caches );
 }
 
 /***********************************************************************
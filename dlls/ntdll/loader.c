@@ -136,10 +136,16 @@ typedef struct _wine_modref
 {
     LDR_DATA_TABLE_ENTRY  ldr;
     struct file_id        id;
+    LIST_ENTRY            id_links;  /* entry in file id hash table */
     ULONG                 CheckSum;
     BOOL                  system;
 } WINE_MODREF;
 
+/* modules are also indexed by base name hash, and by file id */
+#define HASH_MAP_SIZE 32
+static LIST_ENTRY hash_table[HASH_MAP_SIZE];
+static LIST_ENTRY fileid_hash_table[HASH_MAP_SIZE];
+
 static UINT tls_module_count;      /* number of modules with TLS directory */
 static IMAGE_TLS_DIRECTORY *tls_dirs;  /* array of TLS directories */
 LIST_ENTRY tls_links = { &tls_links, &tls_links };
@@ -524,6 +530,49 @@ static WINE_MODREF *get_modref( HMODULE hmod )
 }
 
 
+/**********************************************************************
+ *	    hash_basename
+ *
+ * Return the hash table bucket for a module base name.
+ */
+static LIST_ENTRY *hash_basename( const UNICODE_STRING *name )
+{
+    ULONG hash;
+
+    RtlHashUnicodeString( name, TRUE, HASH_STRING_ALGORITHM_DEFAULT, &hash );
+    return &hash_table[hash % HASH_MAP_SIZE];
+}
+
+
+/**********************************************************************
+ *	    hash_fileid
+ *
+ * Return the file id hash table bucket for a file id.
+ */
+static LIST_ENTRY *hash_fileid( const struct file_id *id )
+{
+    ULONG hash = 0;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(id->ObjectId); i++) hash = hash * 31 + id->ObjectId[i];
+    return &fileid_hash_table[hash % HASH_MAP_SIZE];
+}
+
+
+/**********************************************************************
+ *	    set_module_fileid
+ *
+ * Set the file id of a module and move it to the right hash bucket.
+ * The loader_section must be locked while calling this function
+ */
+static void set_module_fileid( WINE_MODREF *wm, const struct file_id *id )
+{
+    RemoveEntryList( &wm->id_links );
+    wm->id = *id;
+    InsertTailList( hash_fileid( &wm->id ), &wm->id_links );
+}
+
+
 /**********************************************************************
  *	    find_basename_module
  *
@@ -540,10 +589,10 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
     if (cached_modref && RtlEqualUnicodeString( &name_str, &cached_modref->ldr.BaseDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = hash_basename( &name_str );
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        WINE_MODREF *mod = CONTAINING_RECORD(entry, WINE_MODREF, ldr.InLoadOrderLinks);
+        WINE_MODREF *mod = CONTAINING_RECORD(entry, WINE_MODREF, ldr.HashLinks);
         if (RtlEqualUnicodeString( &name_str, &mod->ldr.BaseDllName, TRUE ) && !mod->system)
         {
             cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
@@ -563,7 +612,8 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
 static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
 {
     PLIST_ENTRY mark, entry;
-    UNICODE_STRING name = *nt_name;
+    UNICODE_STRING name = *nt_name, base_name;
+    const WCHAR *p;
 
     if (name.Length <= 4 * sizeof(WCHAR)) return NULL;
     name.Length -= 4 * sizeof(WCHAR);  /* for \??\ prefix */
@@ -572,10 +622,18 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    /* the module is in the bucket of the file part of its full name */
+    base_name = name;
+    for (p = name.Buffer + name.Length / sizeof(WCHAR); p > name.Buffer; p--)
+        if (p[-1] == '\\') break;
+    base_name.Buffer = (WCHAR *)p;
+    base_name.Length -= (p - name.Buffer) * sizeof(WCHAR);
+    base_name.MaximumLength = base_name.Length;
+
+    mark = hash_basename( &base_name );
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
+        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, HashLinks);
         if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
         {
             cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
@@ -598,11 +656,10 @@ static WINE_MODREF *find_fileid_module( const struct file_id *id )
 
     if (cached_modref && !memcmp( &cached_modref->id, id, sizeof(*id) )) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = hash_fileid( id );
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
-        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, id_links );
 
         if (!memcmp( &wm->id, id, sizeof(*id) ))
         {
@@ -1474,6 +1531,10 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
                    &wm->ldr.InLoadOrderLinks);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderLinks);
+    RtlHashUnicodeString( &wm->ldr.BaseDllName, TRUE, HASH_STRING_ALGORITHM_DEFAULT,
+                          &wm->ldr.BaseNameHashValue );
+    InsertTailList( &hash_table[wm->ldr.BaseNameHashValue % HASH_MAP_SIZE], &wm->ldr.HashLinks );
+    InsertTailList( hash_fileid( &wm->id ), &wm->id_links );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -2130,7 +2191,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
 
     if (!(wm = alloc_module( *module, nt_name, is_builtin ))) return STATUS_NO_MEMORY;
 
-    if (id) wm->id = *id;
+    if (id) set_module_fileid( wm, id );
     if (image_info->LoaderFlags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info->ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
     wm->system = system;
@@ -2149,9 +2210,11 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
             status = fixup_imports( wm, load_path );
         if (status != STATUS_SUCCESS)
         {
-            /* the module has only be inserted in the load & memory order lists */
+            /* the module has only be inserted in the load & memory order lists and hash tables */
             RemoveEntryList(&wm->ldr.InLoadOrderLinks);
             RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+            RemoveEntryList(&wm->ldr.HashLinks);
+            RemoveEntryList(&wm->id_links);
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -3828,6 +3891,8 @@ static void free_modref( WINE_MODREF *wm )
 
     RemoveEntryList(&wm->ldr.InLoadOrderLinks);
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+    RemoveEntryList(&wm->ldr.HashLinks);
+    RemoveEntryList(&wm->id_links);
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
 
@@ -4178,6 +4243,7 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, ULONG_PTR unknown2, ULONG_PTR
     ULONG_PTR cookie;
     WINE_MODREF *wm;
     void **entry;
+    unsigned int i;
 
 #ifdef __i386__
     entry = (void **)&context->Eax;
@@ -4217,6 +4283,12 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, ULONG_PTR unknown2, ULONG_PTR
         /* TLS index 0 is always reserved, and wow64 reserves extra TLS entries */
         RtlSetBits( peb->TlsBitmap, 0, NtCurrentTeb()->WowTebOffset ? WOW64_TLS_MAX_NUMBER : 1 );
 
+        for (i = 0; i < HASH_MAP_SIZE; i++)
+        {
+            InitializeListHead( &hash_table[i] );
+            InitializeListHead( &fileid_hash_table[i] );
+        }
+
         init_user_process_params();
         load_global_options();
         version_init();
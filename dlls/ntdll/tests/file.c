@@ -941,7 +941,7 @@ static void WINAPI user_apc_proc(ULONG_PTR arg)
 
 static void test_set_io_completion(void)
 {
-    FILE_IO_COMPLETION_INFORMATION info[2] = {{0}};
+    FILE_IO_COMPLETION_INFORMATION info[2] = {{0}}, infos[80];
     LARGE_INTEGER timeout = {{0}};
     unsigned int apc_count;
     IO_STATUS_BLOCK iosb;
@@ -949,6 +949,7 @@ static void test_set_io_completion(void)
     NTSTATUS res;
     ULONG count;
     SIZE_T size = 3;
+    unsigned int i;
     HANDLE h;
 
     if (sizeof(size) > 4) size |= (ULONGLONG)0x12345678 << 32;
@@ -1075,6 +1076,30 @@ static void test_set_io_completion(void)
 
     SleepEx( 1, TRUE );
 
+    /* remove many completions at once */
+    for (i = 0; i < 100; i++)
+    {
+        res = pNtSetIoCompletion( h, i, i * 2, i * 3, size );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+    }
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, infos, ARRAY_SIZE(infos), &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+    ok( count == ARRAY_SIZE(infos), "wrong count %lu\n", count );
+    for (i = 0; i < count; i++)
+    {
+        ok( infos[i].CompletionKey == i, "%u: wrong key %#Ix\n", i, infos[i].CompletionKey );
+        ok( infos[i].CompletionValue == i * 2, "%u: wrong value %#Ix\n", i, infos[i].CompletionValue );
+        ok( U(infos[i].IoStatusBlock).Status == i * 3, "%u: wrong status %#lx\n", i,
+            U(infos[i].IoStatusBlock).Status );
+    }
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, infos, ARRAY_SIZE(infos), &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+    ok( count == 100 - ARRAY_SIZE(infos), "wrong count %lu\n", count );
+    ok( infos[0].CompletionKey == ARRAY_SIZE(infos), "wrong key %#Ix\n", infos[0].CompletionKey );
+    ok( infos[count - 1].CompletionKey == 99, "wrong key %#Ix\n", infos[count - 1].CompletionKey );
+
     pNtClose( h );
 }
 
@@ -2398,6 +2398,69 @@ static void test_query_region_information(void)
     NtClose(mapping);
 }
 
+static void test_large_pages(void)
+{
+    static const SIZE_T large_page_size = 0x200000;
+    MEMORY_WORKING_SET_EX_INFORMATION info;
+    NTSTATUS status;
+    SIZE_T size;
+    void *ptr;
+
+    /* large pages must be reserved and committed at once */
+    size = large_page_size;
+    ptr = NULL;
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &ptr, 0, &size, MEM_COMMIT | MEM_LARGE_PAGES,
+                                     PAGE_READWRITE);
+    ok(status == STATUS_INVALID_PARAMETER || broken(status == STATUS_PRIVILEGE_NOT_HELD),
+       "Unexpected status %08lx.\n", status);
+
+    size = large_page_size;
+    ptr = NULL;
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &ptr, 0, &size, MEM_RESERVE | MEM_LARGE_PAGES,
+                                     PAGE_READWRITE);
+    ok(status == STATUS_INVALID_PARAMETER || broken(status == STATUS_PRIVILEGE_NOT_HELD),
+       "Unexpected status %08lx.\n", status);
+
+    /* in whole large pages */
+    size = large_page_size + page_size;
+    ptr = NULL;
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &ptr, 0, &size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(status == STATUS_INVALID_PARAMETER || broken(status == STATUS_PRIVILEGE_NOT_HELD),
+       "Unexpected status %08lx.\n", status);
+
+    size = large_page_size;
+    ptr = (char *)(is_win64 ? 0x100000000 : 0x10000000) + 0x10000;
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &ptr, 0, &size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(status == STATUS_INVALID_PARAMETER || broken(status == STATUS_PRIVILEGE_NOT_HELD),
+       "Unexpected status %08lx.\n", status);
+
+    /* Windows requires SeLockMemoryPrivilege */
+    size = large_page_size;
+    ptr = NULL;
+    status = NtAllocateVirtualMemory(NtCurrentProcess(), &ptr, 0, &size,
+                                     MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!status || broken(status == STATUS_PRIVILEGE_NOT_HELD), "Unexpected status %08lx.\n", status);
+    if (status) return;
+
+    ok(!((ULONG_PTR)ptr & (large_page_size - 1)), "Unexpected address %p.\n", ptr);
+    ok(size == large_page_size, "Unexpected size %#Ix.\n", size);
+    memset(ptr, 0x11, size);
+
+    memset(&info, 0, sizeof(info));
+    info.VirtualAddress = ptr;
+    status = NtQueryVirtualMemory(NtCurrentProcess(), NULL, MemoryWorkingSetExInformation, &info, sizeof(info), NULL);
+    ok(!status, "Unexpected status %08lx.\n", status);
+    ok(info.VirtualAttributes.Valid, "Page is not valid.\n");
+    ok(info.VirtualAttributes.Win32Protection == PAGE_READWRITE, "Unexpected protection %#lx.\n",
+       (ULONG)info.VirtualAttributes.Win32Protection);
+
+    size = 0;
+    status = NtFreeVirtualMemory(NtCurrentProcess(), &ptr, &size, MEM_RELEASE);
+    ok(!status, "Unexpected status %08lx.\n", status);
+}
+
 START_TEST(virtual)
 {
     HMODULE mod;
@@ -2447,4 +2510,5 @@ START_TEST(virtual)
     test_user_shared_data();
     test_syscalls();
     test_query_region_information();
+    test_large_pages();
 }
@@ -366,6 +366,7 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled );
 static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread );
 static void tp_object_prepare_shutdown( struct threadpool_object *object );
 static BOOL tp_object_release( struct threadpool_object *object );
+static BOOL tp_threadpool_release( struct threadpool *pool );
 static struct threadpool *default_threadpool = NULL;
 
 static BOOL array_reserve(void **elements, unsigned int *capacity, unsigned int count, unsigned int size)
@@ -1163,6 +1164,53 @@ static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
     return status;
 }
 
+/***********************************************************************
+ *           tp_reserve_worker_thread    (internal)
+ *
+ * Account a new worker thread for the desired pool, pool->cs has to be
+ * held. The thread has to be started with tp_start_worker_thread once
+ * the critical section has been left.
+ */
+static void tp_reserve_worker_thread( struct threadpool *pool )
+{
+    InterlockedIncrement( &pool->refcount );
+    pool->num_workers++;
+}
+
+/***********************************************************************
+ *           tp_start_worker_thread    (internal)
+ *
+ * Start a worker thread previously accounted with tp_reserve_worker_thread.
+ * Creating a thread requires a server round-trip, so this is done without
+ * holding pool->cs.
+ */
+static NTSTATUS tp_start_worker_thread( struct threadpool *pool )
+{
+    HANDLE thread;
+    NTSTATUS status;
+
+    status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0,
+                                  pool->stack_info.StackReserve, pool->stack_info.StackCommit,
+                                  threadpool_worker_proc, pool, &thread, NULL );
+    if (status == STATUS_SUCCESS)
+    {
+        NtClose( thread );
+        return status;
+    }
+
+    RtlEnterCriticalSection( &pool->cs );
+    pool->num_workers--;
+    /* Other workers may have terminated in the meantime, make sure that
+     * the queued work items are still processed. */
+    if (!pool->num_workers && tp_new_worker_thread( pool ))
+        ERR( "failed to create worker thread for pool %p\n", pool );
+    RtlWakeConditionVariable( &pool->update_event );
+    RtlLeaveCriticalSection( &pool->cs );
+
+    tp_threadpool_release( pool );
+    return status;
+}
+
 /***********************************************************************
  *           tp_timerqueue_lock    (internal)
  *
@@ -1982,7 +2030,7 @@ static void tp_object_prio_queue( struct threadpool_object *object )
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
-    NTSTATUS status = STATUS_UNSUCCESSFUL;
+    BOOL new_thread = FALSE;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
@@ -1992,7 +2040,10 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     /* Start new worker threads if required. */
     if (pool->num_busy_workers >= pool->num_workers &&
         pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    {
+        tp_reserve_worker_thread( pool );
+        new_thread = TRUE;
+    }
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
@@ -2004,13 +2055,15 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
         object->u.wait.signaled++;
 
     /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
+    if (!new_thread)
     {
         assert( pool->num_workers > 0 );
         RtlWakeConditionVariable( &pool->update_event );
     }
 
     RtlLeaveCriticalSection( &pool->cs );
+
+    if (new_thread) tp_start_worker_thread( pool );
 }
 
 /***********************************************************************
@@ -2612,6 +2665,7 @@ NTSTATUS WINAPI TpCallbackMayRunLong( TP_CALLBACK_INSTANCE *instance )
     struct threadpool_object *object = this->object;
     struct threadpool *pool;
     NTSTATUS status = STATUS_SUCCESS;
+    BOOL new_thread = FALSE;
 
     TRACE( "%p\n", instance );
 
@@ -2632,7 +2686,8 @@ NTSTATUS WINAPI TpCallbackMayRunLong( TP_CALLBACK_INSTANCE *instance )
     {
         if (pool->num_workers < pool->max_workers)
         {
-            status = tp_new_worker_thread( pool );
+            tp_reserve_worker_thread( pool );
+            new_thread = TRUE;
         }
         else
         {
@@ -2641,6 +2696,8 @@ NTSTATUS WINAPI TpCallbackMayRunLong( TP_CALLBACK_INSTANCE *instance )
     }
 
     RtlLeaveCriticalSection( &pool->cs );
+
+    if (new_thread) status = tp_start_worker_thread( pool );
     this->may_run_long = TRUE;
     return status;
 }
@@ -2699,6 +2699,246 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* index of the entries of a directory by case-insensitive name */
+struct dir_name_cache
+{
+    char         *path;        /* unix path of the directory */
+    dev_t         dev;         /* device of the directory */
+    ino_t         ino;         /* inode of the directory */
+    ULONGLONG     mtime;       /* modification time when the directory was first seen */
+    unsigned int  last_use;    /* value of the lookup counter when last used */
+    BOOL          short_names; /* whether hashed short names are indexed too */
+    unsigned int  count;       /* number of entries */
+    unsigned int  hash_mask;   /* number of buckets - 1 */
+    unsigned int *buckets;     /* first entry of each bucket, or ~0; NULL if not built yet */
+    struct dir_name_entry
+    {
+        unsigned int hash;     /* hash of the upper-cased name */
+        unsigned int next;     /* next entry in the bucket, or ~0 */
+        unsigned int name;     /* offset of the unix name in the names buffer */
+        BOOL         is_short; /* entry is for the hashed short name of the file */
+    }            *entries;
+    char         *names;       /* buffer of null-terminated unix names */
+};
+
+#define DIR_NAME_CACHE_SIZE 64
+static struct dir_name_cache dir_name_cache[DIR_NAME_CACHE_SIZE];
+static unsigned int dir_name_cache_counter;
+static pthread_mutex_t dir_name_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ULONGLONG get_dir_mtime( const struct stat *st )
+{
+    ULONGLONG mtime = ticks_from_time_t( st->st_mtime );
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime += st->st_mtim.tv_nsec / 100;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime += st->st_mtimespec.tv_nsec / 100;
+#endif
+    return mtime;
+}
+
+static unsigned int hash_dir_entry_name( const WCHAR *name, int length )
+{
+    unsigned int hash = 0;
+    int i;
+
+    for (i = 0; i < length; i++) hash = hash * 31 + towupper( name[i] );
+    return hash;
+}
+
+static void free_dir_name_cache( struct dir_name_cache *cache )
+{
+    free( cache->path );
+    free( cache->buckets );
+    free( cache->entries );
+    free( cache->names );
+    memset( cache, 0, sizeof(*cache) );
+}
+
+/* read the directory and build its name index; helper for lookup_dir_name_cache */
+static BOOL build_dir_name_cache( struct dir_name_cache *cache, const char *path, const struct stat *st )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    unsigned int i, size = 0, names_size = 4096, nb_entries = 64;
+    struct dir_name_entry *entries = NULL;
+    char *names = NULL;
+    struct dirent *de;
+    DIR *dir;
+    void *ptr;
+    int ret;
+
+#ifdef VFAT_IOCTL_READDIR_BOTH
+    /* real short names on VFAT are not the hashed ones, leave them to find_file_in_dir */
+    cache->short_names = TRUE;
+    if ((ret = open( path, O_RDONLY | O_DIRECTORY )) != -1)
+    {
+        KERNEL_DIRENT kde[2];
+
+        if (ioctl( ret, VFAT_IOCTL_READDIR_BOTH, (long)kde ) != -1) cache->short_names = FALSE;
+        close( ret );
+    }
+#else
+    cache->short_names = TRUE;
+#endif
+
+    if (!(dir = opendir( path ))) return FALSE;
+    if (!(entries = malloc( nb_entries * sizeof(*entries) ))) goto failed;
+    if (!(names = malloc( names_size ))) goto failed;
+
+    cache->count = 0;
+    while ((de = readdir( dir )))
+    {
+        int len = strlen( de->d_name ) + 1;
+
+        ret = ntdll_umbstowcs( de->d_name, len - 1, buffer, MAX_DIR_ENTRY_LEN );
+        if (cache->count + 1 >= nb_entries)
+        {
+            if (!(ptr = realloc( entries, nb_entries * 2 * sizeof(*entries) ))) goto failed;
+            entries = ptr;
+            nb_entries *= 2;
+        }
+        if (size + len > names_size)
+        {
+            while (size + len > names_size) names_size *= 2;
+            if (!(ptr = realloc( names, names_size ))) goto failed;
+            names = ptr;
+        }
+        memcpy( names + size, de->d_name, len );
+        entries[cache->count].hash = hash_dir_entry_name( buffer, ret );
+        entries[cache->count].name = size;
+        entries[cache->count].is_short = FALSE;
+        cache->count++;
+        if (cache->short_names && !is_legal_8dot3_name( buffer, ret ))
+        {
+            WCHAR short_nameW[12];
+
+            ret = hash_short_file_name( buffer, ret, short_nameW );
+            entries[cache->count].hash = hash_dir_entry_name( short_nameW, ret );
+            entries[cache->count].name = size;
+            entries[cache->count].is_short = TRUE;
+            cache->count++;
+        }
+        size += len;
+    }
+    closedir( dir );
+    dir = NULL;
+
+    for (cache->hash_mask = 15; cache->hash_mask < cache->count; cache->hash_mask = cache->hash_mask * 2 + 1) ;
+    if (!(cache->buckets = malloc( (cache->hash_mask + 1) * sizeof(*cache->buckets) ))) goto failed;
+    memset( cache->buckets, 0xff, (cache->hash_mask + 1) * sizeof(*cache->buckets) );
+    /* insert in reverse order, so that the first entry returned by readdir wins */
+    for (i = cache->count; i--; )
+    {
+        unsigned int *bucket = &cache->buckets[entries[i].hash & cache->hash_mask];
+        entries[i].next = *bucket;
+        *bucket = i;
+    }
+
+    cache->entries = entries;
+    cache->names   = names;
+    return TRUE;
+
+failed:
+    if (dir) closedir( dir );
+    free( entries );
+    free( names );
+    free_dir_name_cache( cache );
+    return FALSE;
+}
+
+/***********************************************************************
+ *           lookup_dir_name_cache
+ *
+ * Look for a file name in the cached index of a directory. The index is only
+ * built on the second miss in the same directory, so that directories that are
+ * searched once don't pay for reading them fully.
+ * Returns 1 and appends the name to unix_name at pos if found, 0 if not found,
+ * and -1 if the directory is not indexed and must be searched by hand.
+ */
+static int lookup_dir_name_cache( char *unix_name, int pos, const WCHAR *name, int length,
+                                  BOOLEAN is_name_8_dot_3 )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_name_cache *cache = NULL;
+    struct stat st;
+    unsigned int i;
+    int len, ret = 0;
+
+    /* unix_name contains the directory path at this point */
+    if (stat( unix_name, &st ) == -1) return -1;
+    /* directory modified too recently, we wouldn't notice further changes in the same tick */
+    if (st.st_mtime >= time( NULL ) - 1) return -1;
+
+    mutex_lock( &dir_name_cache_mutex );
+
+    for (i = 0; i < DIR_NAME_CACHE_SIZE; i++)
+    {
+        if (!dir_name_cache[i].path) continue;
+        if (dir_name_cache[i].dev != st.st_dev || dir_name_cache[i].ino != st.st_ino) continue;
+        if (strcmp( dir_name_cache[i].path, unix_name )) continue;
+        cache = &dir_name_cache[i];
+        break;
+    }
+    if (cache && cache->mtime != get_dir_mtime( &st ))
+    {
+        free_dir_name_cache( cache );
+        cache = NULL;
+    }
+    if (!cache)
+    {
+        /* replace the least recently used entry, and only remember the miss for now */
+        cache = &dir_name_cache[0];
+        for (i = 1; i < DIR_NAME_CACHE_SIZE; i++)
+            if (dir_name_cache_counter - dir_name_cache[i].last_use >
+                dir_name_cache_counter - cache->last_use) cache = &dir_name_cache[i];
+        free_dir_name_cache( cache );
+        if ((cache->path = strdup( unix_name )))
+        {
+            cache->dev      = st.st_dev;
+            cache->ino      = st.st_ino;
+            cache->mtime    = get_dir_mtime( &st );
+            cache->last_use = ++dir_name_cache_counter;
+        }
+        mutex_unlock( &dir_name_cache_mutex );
+        return -1;
+    }
+    cache->last_use = ++dir_name_cache_counter;
+    if (!cache->buckets && !build_dir_name_cache( cache, unix_name, &st ))
+    {
+        mutex_unlock( &dir_name_cache_mutex );
+        return -1;
+    }
+
+    for (i = cache->buckets[hash_dir_entry_name( name, length ) & cache->hash_mask]; i != ~0u;
+         i = cache->entries[i].next)
+    {
+        const char *entry = cache->names + cache->entries[i].name;
+
+        len = ntdll_umbstowcs( entry, strlen(entry), buffer, MAX_DIR_ENTRY_LEN );
+        if (cache->entries[i].is_short)
+        {
+            WCHAR short_nameW[12];
+
+            if (hash_short_file_name( buffer, len, short_nameW ) != length) continue;
+            if (wcsnicmp( short_nameW, name, length )) continue;
+        }
+        else
+        {
+            if (len != length) continue;
+            if (wcsnicmp( buffer, name, length )) continue;
+        }
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, entry );
+        ret = 1;
+        break;
+    }
+    if (!ret && is_name_8_dot_3 && !cache->short_names) ret = -1;
+
+    mutex_unlock( &dir_name_cache_mutex );
+    return ret;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2739,6 +2979,16 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 
     if (!is_name_8_dot_3 && !get_dir_case_sensitivity( unix_name )) goto not_found;
 
+    /* look for it in the cached directory index */
+
+    switch (lookup_dir_name_cache( unix_name, pos, name, length, is_name_8_dot_3 ))
+    {
+    case 1:
+        return STATUS_SUCCESS;
+    case 0:
+        goto not_found;
+    }
+
     /* now look for it through the directory */
 
 #ifdef VFAT_IOCTL_READDIR_BOTH
@@ -6014,6 +6264,56 @@ static void ignore_server_ioctl_struct_holes( ULONG code, const void *in_buffer,
 }
 
 
+/* copy a range of data between two files, letting the kernel share the blocks when possible */
+static NTSTATUS duplicate_extents( HANDLE handle, const DUPLICATE_EXTENTS_DATA *data )
+{
+#ifdef HAVE_COPY_FILE_RANGE
+    int src_fd, dst_fd, src_needs_close, dst_needs_close;
+    enum server_fd_type src_type, dst_type;
+    off_t src_pos = data->SourceFileOffset.QuadPart;
+    off_t dst_pos = data->TargetFileOffset.QuadPart;
+    ULONGLONG count = data->ByteCount.QuadPart;
+    HANDLE source = data->FileHandle;
+    NTSTATUS status;
+    ssize_t ret;
+
+    if (src_pos < 0 || dst_pos < 0) return STATUS_INVALID_PARAMETER;
+    if (in_wow64_call()) source = LongToHandle( HandleToLong( source ));
+
+    if ((status = server_get_unix_fd( source, FILE_READ_DATA, &src_fd, &src_needs_close, &src_type, NULL )))
+        return status;
+    if ((status = server_get_unix_fd( handle, FILE_WRITE_DATA, &dst_fd, &dst_needs_close, &dst_type, NULL )))
+    {
+        if (src_needs_close) close( src_fd );
+        return status;
+    }
+
+    if (src_type != FD_TYPE_FILE || dst_type != FD_TYPE_FILE) status = STATUS_INVALID_DEVICE_REQUEST;
+    else while (count)
+    {
+        if ((ret = copy_file_range( src_fd, &src_pos, dst_fd, &dst_pos, min( count, 0x40000000 ), 0 )) > 0)
+            count -= ret;
+        else if (!ret) break;  /* end of source file */
+        else if (errno != EINTR)
+        {
+            /* cross-device or unsupported, the caller is expected to fall back to a plain copy */
+            if (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)
+                status = STATUS_INVALID_DEVICE_REQUEST;
+            else
+                status = errno_to_status( errno );
+            break;
+        }
+    }
+
+    if (src_needs_close) close( src_fd );
+    if (dst_needs_close) close( dst_fd );
+    return status;
+#else
+    return STATUS_INVALID_DEVICE_REQUEST;
+#endif
+}
+
+
 /******************************************************************************
  *              NtFsControlFile   (NTDLL.@)
  */
@@ -6112,6 +6412,13 @@ NTSTATUS WINAPI NtFsControlFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
         io->Information = 0;
         status = STATUS_SUCCESS;
         break;
+
+    case FSCTL_DUPLICATE_EXTENTS_TO_FILE:
+        io->Information = 0;
+        if (!in_buffer || in_size < sizeof(DUPLICATE_EXTENTS_DATA)) status = STATUS_INVALID_PARAMETER;
+        else status = duplicate_extents( handle, in_buffer );
+        break;
+
     default:
         return server_ioctl_file( handle, event, apc, apc_context, io, code,
                                   in_buffer, in_size, out_buffer, out_size );
@@ -37,6 +37,7 @@
 #ifdef HAVE_PWD_H
 # include <pwd.h>
 #endif
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -1146,6 +1147,191 @@ done:
 }
 
 
+/***********************************************************************/
+/* in-process synchronization support */
+
+union inproc_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        int                   fd;
+        enum inproc_sync_type type : 8;
+        unsigned int          access : 24;
+    } s;
+};
+
+C_ASSERT( sizeof(union inproc_sync_cache_entry) == sizeof(LONG64) );
+
+static union inproc_sync_cache_entry *inproc_sync_cache[FD_CACHE_ENTRIES];
+
+static BOOL inproc_sync_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEINPROCSYNC" );
+        enabled = env && atoi( env );
+    }
+    return enabled;
+}
+
+
+/***********************************************************************
+ *           add_inproc_sync_to_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static BOOL add_inproc_sync_to_cache( HANDLE handle, int fd, enum inproc_sync_type type,
+                                      unsigned int access )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union inproc_sync_cache_entry cache;
+
+    if (!inproc_sync_cache[entry])
+    {
+        void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union inproc_sync_cache_entry),
+                                     PROT_READ | PROT_WRITE );
+        if (ptr == MAP_FAILED) return FALSE;
+        inproc_sync_cache[entry] = ptr;
+    }
+
+    /* store fd+1 so that 0 can be used as the unset value */
+    cache.s.fd = fd + 1;
+    cache.s.type = type;
+    cache.s.access = access;
+    cache.data = interlocked_xchg64( &inproc_sync_cache[entry][idx].data, cache.data );
+    assert( !cache.s.fd );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           get_cached_inproc_sync
+ */
+static inline enum inproc_sync_type get_cached_inproc_sync( HANDLE handle, int *fd, unsigned int *access )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union inproc_sync_cache_entry cache;
+
+    if (!inproc_sync_cache[entry]) return INPROC_SYNC_UNKNOWN;
+    cache.data = InterlockedCompareExchange64( &inproc_sync_cache[entry][idx].data, 0, 0 );
+    if (!cache.data) return INPROC_SYNC_UNKNOWN;
+
+    *fd = cache.s.fd - 1;
+    *access = cache.s.access;
+    return cache.s.type;
+}
+
+
+/***********************************************************************
+ *           remove_inproc_sync_from_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static int remove_inproc_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    int fd = -1;
+
+    if (entry < FD_CACHE_ENTRIES && inproc_sync_cache[entry])
+    {
+        union inproc_sync_cache_entry cache;
+        cache.data = interlocked_xchg64( &inproc_sync_cache[entry][idx].data, 0 );
+        fd = cache.s.fd - 1;
+    }
+
+    return fd;
+}
+
+
+/***********************************************************************
+ *           server_get_inproc_sync_fd
+ *
+ * Retrieve the fd used to synchronize on an object without server calls.
+ * Returns -1 if the object doesn't support it. The fd must not be closed.
+ */
+int server_get_inproc_sync_fd( HANDLE handle, enum inproc_sync_type *type, unsigned int *access )
+{
+    unsigned int entry, ret;
+    obj_handle_t fd_handle;
+    sigset_t sigset;
+    int fd = -1;
+
+    if (!inproc_sync_enabled()) return -1;
+    handle_to_index( handle, &entry );
+    if (entry >= FD_CACHE_ENTRIES) return -1;
+
+    if ((*type = get_cached_inproc_sync( handle, &fd, access )) != INPROC_SYNC_UNKNOWN)
+        return *type == INPROC_SYNC_NONE ? -1 : fd;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if ((*type = get_cached_inproc_sync( handle, &fd, access )) == INPROC_SYNC_UNKNOWN)
+    {
+        SERVER_START_REQ( get_inproc_sync_fd )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            if (!(ret = wine_server_call( req )))
+            {
+                *type = reply->type;
+                *access = reply->access;
+                fd = receive_fd( &fd_handle );
+                assert( wine_server_ptr_handle(fd_handle) == handle );
+            }
+            else if (ret != STATUS_INVALID_HANDLE)
+            {
+                *type = INPROC_SYNC_NONE;
+                *access = 0;
+            }
+        }
+        SERVER_END_REQ;
+
+        if (*type != INPROC_SYNC_UNKNOWN && !add_inproc_sync_to_cache( handle, fd, *type, *access ))
+        {
+            if (fd != -1) close( fd );
+            *type = INPROC_SYNC_NONE;
+        }
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    return *type == INPROC_SYNC_NONE ? -1 : fd;
+}
+
+
+/***********************************************************************
+ *           server_inproc_apc_pending
+ *
+ * Check without a server call whether system APCs are queued for the current thread.
+ * Returns TRUE if it can't be determined.
+ */
+BOOL server_inproc_apc_pending(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    obj_handle_t fd_handle;
+    struct pollfd pfd;
+    sigset_t sigset;
+    int fd = -1;
+
+    if (thread_data->inproc_apc_fd == -1)
+    {
+        server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+        SERVER_START_REQ( get_inproc_apc_fd )
+        {
+            if (!wine_server_call( req )) fd = receive_fd( &fd_handle );
+        }
+        SERVER_END_REQ;
+        server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+        if (fd == -1) return TRUE;
+        thread_data->inproc_apc_fd = fd;
+    }
+
+    pfd.fd = thread_data->inproc_apc_fd;
+    pfd.events = POLLIN;
+    return poll( &pfd, 1, 0 ) != 0;
+}
+
+
 /***********************************************************************
  *           wine_server_fd_to_handle
  */
@@ -1750,7 +1936,7 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
 {
     sigset_t sigset;
     unsigned int ret;
-    int fd = -1;
+    int fd = -1, sync_fd = -1;
 
     if (dest) *dest = 0;
 
@@ -1780,7 +1966,10 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        sync_fd = remove_inproc_sync_from_cache( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1800,6 +1989,7 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
 
     if (fd != -1) close( fd );
+    if (sync_fd != -1) close( sync_fd );
     return ret;
 }
 
@@ -1831,7 +2021,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     sigset_t sigset;
     HANDLE port;
     unsigned int ret;
-    int fd;
+    int fd, sync_fd;
 
     if (HandleToLong( handle ) >= ~5 && HandleToLong( handle ) <= ~0)
         return STATUS_SUCCESS;
@@ -1841,6 +2031,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    sync_fd = remove_inproc_sync_from_cache( handle );
 
     SERVER_START_REQ( close_handle )
     {
@@ -1852,6 +2043,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
 
     if (fd != -1) close( fd );
+    if (sync_fd != -1) close( sync_fd );
 
     if (ret != STATUS_INVALID_HANDLE || !handle) return ret;
     if (!peb->BeingDebugged) return ret;
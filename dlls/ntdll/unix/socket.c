@@ -29,6 +29,9 @@
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
 #endif
@@ -136,6 +139,7 @@ struct async_transmit_ioctl
 {
     struct async_fileio io;
     HANDLE file;
+    BOOL no_sendfile;           /* file data has to be sent through the buffer */
     char *buffer;
     unsigned int buffer_size;   /* allocated size of buffer */
     unsigned int read_len;      /* amount of valid data currently in the buffer */
@@ -1263,10 +1267,43 @@ static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_io
         async->file_cursor += ret;
     }
 
+#ifdef HAVE_SYS_SENDFILE_H
+    while (async->file && async->buffer_cursor == async->read_len && !async->no_sendfile)
+    {
+        size_t send_size = async->file_len ? async->file_len - async->file_cursor : 0x7ffff000;
+        off_t offset = async->offset.QuadPart;
+
+        TRACE( "sending %zu bytes of file data with sendfile\n", send_size );
+        if (async->offset.QuadPart == FILE_USE_FILE_POINTER_POSITION)
+            ret = sendfile( sock_fd, file_fd, NULL, send_size );
+        else
+            ret = sendfile( sock_fd, file_fd, &offset, send_size );
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EWOULDBLOCK) return STATUS_DEVICE_NOT_READY;
+            /* the file or socket type is not supported, fall back to read and send */
+            WARN( "sendfile: %s\n", strerror( errno ) );
+            async->no_sendfile = TRUE;
+            break;
+        }
+        TRACE( "sendfile returned %zd\n", ret );
+
+        async->file_cursor += ret;
+        if (async->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            async->offset.QuadPart += ret;
+        if (!ret || (async->file_len && async->file_cursor == async->file_len))
+            async->file = NULL;
+    }
+#endif
+
     if (async->file && async->buffer_cursor == async->read_len)
     {
         unsigned int read_size = async->buffer_size;
 
+        if (!async->buffer && !(async->buffer = malloc( async->buffer_size )))
+            return STATUS_NO_MEMORY;
+
         if (async->file_len)
             read_size = min( read_size, async->file_len - async->file_cursor );
 
@@ -1369,12 +1406,9 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
         return STATUS_NO_MEMORY;
 
     async->file = ULongToHandle( params->file );
+    async->no_sendfile = FALSE;
+    async->buffer = NULL;  /* allocated on first use if sendfile is not available */
     async->buffer_size = params->buffer_size ? params->buffer_size : 65536;
-    if (!(async->buffer = malloc( async->buffer_size )))
-    {
-        release_fileio( &async->io );
-        return STATUS_NO_MEMORY;
-    }
     async->read_len = 0;
     async->head_cursor = 0;
     async->file_cursor = 0;
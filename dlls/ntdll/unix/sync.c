@@ -423,6 +423,22 @@ NTSTATUS WINAPI NtOpenEvent( HANDLE *handle, ACCESS_MASK access, const OBJECT_AT
 }
 
 
+/* set or reset an event through its in-process fd, return FALSE if not possible */
+static BOOL inproc_event_op( HANDLE handle, enum event_op op )
+{
+    enum inproc_sync_type type;
+    unsigned int access;
+    ULONG64 value = 1;
+    int fd;
+
+    if ((fd = server_get_inproc_sync_fd( handle, &type, &access )) == -1) return FALSE;
+    if (!(access & EVENT_MODIFY_STATE)) return FALSE;
+
+    if (op == SET_EVENT) return write( fd, &value, sizeof(value) ) == sizeof(value);
+    return read( fd, &value, sizeof(value) ) == sizeof(value) || errno == EAGAIN;
+}
+
+
 /******************************************************************************
  *              NtSetEvent (NTDLL.@)
  */
@@ -430,6 +446,8 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if (!prev_state && inproc_event_op( handle, SET_EVENT )) return STATUS_SUCCESS;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -449,6 +467,8 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if (!prev_state && inproc_event_op( handle, RESET_EVENT )) return STATUS_SUCCESS;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1461,6 +1481,41 @@ NTSTATUS WINAPI NtQueryTimer( HANDLE handle, TIMER_INFORMATION_CLASS class,
 }
 
 
+/* try to acquire one of the objects through their in-process fds, without blocking;
+ * return STATUS_PENDING if the server needs to be involved */
+static NTSTATUS inproc_wait_any( DWORD count, const HANDLE *handles )
+{
+    enum inproc_sync_type types[MAXIMUM_WAIT_OBJECTS];
+    int fds[MAXIMUM_WAIT_OBJECTS];
+    unsigned int access;
+    struct pollfd pfd;
+    ULONG64 value;
+    DWORD i;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((fds[i] = server_get_inproc_sync_fd( handles[i], &types[i], &access )) == -1)
+            return STATUS_PENDING;
+        if (!(access & SYNCHRONIZE)) return STATUS_PENDING;
+    }
+
+    /* pending system APCs are only delivered by the server */
+    if (server_inproc_apc_pending()) return STATUS_PENDING;
+
+    for (i = 0; i < count; i++)
+    {
+        if (types[i] == INPROC_SYNC_MANUAL_EVENT)
+        {
+            pfd.fd = fds[i];
+            pfd.events = POLLIN;
+            if (poll( &pfd, 1, 0 ) == 1 && (pfd.revents & POLLIN)) return STATUS_WAIT_0 + i;
+        }
+        else if (read( fds[i], &value, sizeof(value) ) == sizeof(value)) return STATUS_WAIT_0 + i;
+    }
+    return STATUS_PENDING;
+}
+
+
 /******************************************************************
  *		NtWaitForMultipleObjects (NTDLL.@)
  */
@@ -1469,9 +1524,14 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
 {
     select_op_t select_op;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    /* the uncontended case doesn't need the server; blocking and alertable waits do */
+    if (wait_any && !alertable && (ret = inproc_wait_any( count, handles )) != STATUS_PENDING)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1915,8 +1975,9 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+    struct completion_info msgs[64];
     unsigned int status;
-    ULONG i = 0;
+    ULONG i = 0, j, size;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, (int)count, written, timeout, alertable );
 
@@ -1924,20 +1985,24 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
     {
         while (i < count)
         {
-            SERVER_START_REQ( remove_completion )
+            /* retrieve as many completions as possible in a single request */
+            SERVER_START_REQ( remove_completions )
             {
                 req->handle = wine_server_obj_handle( handle );
-                if (!(status = wine_server_call( req )))
-                {
-                    info[i].CompletionKey             = reply->ckey;
-                    info[i].CompletionValue           = reply->cvalue;
-                    info[i].IoStatusBlock.Information = reply->information;
-                    info[i].IoStatusBlock.Status      = reply->status;
-                }
+                wine_server_set_reply( req, msgs, min( count - i, ARRAY_SIZE(msgs) ) * sizeof(msgs[0]) );
+                status = wine_server_call( req );
+                size = wine_server_reply_size( reply ) / sizeof(msgs[0]);
             }
             SERVER_END_REQ;
             if (status != STATUS_SUCCESS) break;
-            ++i;
+            for (j = 0; j < size; j++, i++)
+            {
+                info[i].CompletionKey             = msgs[j].ckey;
+                info[i].CompletionValue           = msgs[j].cvalue;
+                info[i].IoStatusBlock.Information = msgs[j].information;
+                info[i].IoStatusBlock.Status      = msgs[j].status;
+            }
+            if (size < ARRAY_SIZE(msgs)) break;
         }
         if (i || status != STATUS_PENDING)
         {
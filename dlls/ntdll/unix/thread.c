@@ -1082,6 +1082,7 @@ static void pthread_exit_wrapper( int status )
 {
     close( ntdll_get_thread_data()->wait_fd[0] );
     close( ntdll_get_thread_data()->wait_fd[1] );
+    close( ntdll_get_thread_data()->inproc_apc_fd );
     close( ntdll_get_thread_data()->reply_fd );
     close( ntdll_get_thread_data()->request_fd );
     pthread_exit( UIntToPtr(status) );
@@ -149,11 +149,13 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 };
 
 static struct wine_rb_tree views_tree;
+static struct file_view *last_view;  /* last view returned by find_view */
 static pthread_mutex_t virtual_mutex;
 
 static const UINT page_shift = 12;
 static const UINT_PTR page_mask = 0xfff;
 static const UINT_PTR granularity_mask = 0xffff;
+static const UINT_PTR large_page_mask = 0x1fffff;
 
 /* Note: these are Windows limits, you cannot change them. */
 #ifdef __i386__
@@ -1188,17 +1190,23 @@ static void VIRTUAL_Dump(void)
 static struct file_view *find_view( const void *addr, size_t size )
 {
     struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *view = last_view;
 
     if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
 
+    /* repeated operations on the same region are common, check the last view first */
+    if (view && view->base <= addr && (const char *)addr < (const char *)view->base + view->size &&
+        (const char *)addr + size <= (const char *)view->base + view->size)
+        return view;
+
     while (ptr)
     {
-        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
 
         if (view->base > addr) ptr = ptr->left;
         else if ((const char *)view->base + view->size <= (const char *)addr) ptr = ptr->right;
         else if ((const char *)view->base + view->size < (const char *)addr + size) break;  /* size too large */
-        else return view;
+        else return last_view = view;
     }
     return NULL;
 }
@@ -1518,6 +1526,7 @@ static void free_view( struct file_view *view )
  */
 static void unregister_view( struct file_view *view )
 {
+    if (view == last_view) last_view = NULL;
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_remove_view( view );
     wine_rb_remove( &views_tree, &view->entry );
@@ -1935,6 +1944,20 @@ failed:
     return status;
 }
 
+/***********************************************************************
+ *           set_large_pages
+ *
+ * Ask the kernel to back a SEC_LARGE_PAGES view with transparent huge pages.
+ */
+static void set_large_pages( struct file_view *view )
+{
+#ifdef MADV_HUGEPAGE
+    if (madvise( view->base, view->size, MADV_HUGEPAGE ))
+        WARN( "no huge pages for %p-%p, errno %d\n", view->base, (char *)view->base + view->size, errno );
+#endif
+}
+
+
 /***********************************************************************
  *           map_view
  *
@@ -2951,11 +2974,13 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
 
-    res = map_view( &view, base, size, alloc_type, vprot, limit, 0 );
+    res = map_view( &view, base, size, alloc_type, vprot, limit,
+                    (sec_flags & SEC_LARGE_PAGES) ? large_page_mask : 0 );
     if (res) goto done;
 
     TRACE( "handle=%p size=%lx offset=%s\n", handle, size, wine_dbgstr_longlong(offset.QuadPart) );
     res = map_file_into_view( view, unix_handle, 0, size, offset.QuadPart, vprot, needs_close );
+    if (res == STATUS_SUCCESS && (sec_flags & SEC_LARGE_PAGES)) set_large_pages( view );
     if (res == STATUS_SUCCESS)
     {
         SERVER_START_REQ( map_view )
@@ -3319,6 +3344,7 @@ static TEB *init_teb( void *ptr, BOOL is_wow )
     thread_data->reply_fd   = -1;
     thread_data->wait_fd[0] = -1;
     thread_data->wait_fd[1] = -1;
+    thread_data->inproc_apc_fd = -1;
     list_add_head( &teb_list, &thread_data->entry );
     return teb;
 }
@@ -3649,6 +3675,13 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
     char *page = ROUND_ADDR( addr, page_mask );
     BYTE vprot;
 
+    /* the protection bytes are never freed, so we can check without the lock whether
+     * this can be anything else than a plain access violation */
+    vprot = get_page_vprot( page );
+    if (!(vprot & (VPROT_GUARD | VPROT_WRITEWATCH)) &&
+        (!(err & EXCEPTION_WRITE_FAULT) || !(get_unix_prot( vprot ) & PROT_WRITE)))
+        return ret;
+
     mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
     vprot = get_page_vprot( page );
     if (!is_inside_signal_stack( stack ) && (vprot & VPROT_GUARD))
@@ -4163,6 +4196,13 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
     }
 
     if (type & MEM_RESERVE_PLACEHOLDER && (protect != PAGE_NOACCESS)) return STATUS_INVALID_PARAMETER;
+    if (type & MEM_LARGE_PAGES)
+    {
+        /* large pages are always reserved and committed at once, in whole large pages */
+        if ((type & (MEM_RESERVE | MEM_COMMIT)) != (MEM_RESERVE | MEM_COMMIT)) return STATUS_INVALID_PARAMETER;
+        if ((size & large_page_mask) || ((UINT_PTR)base & large_page_mask)) return STATUS_INVALID_PARAMETER;
+        if (align && (align - 1) < large_page_mask) return STATUS_INVALID_PARAMETER;
+    }
     if (!arm64ec_map && (attributes & MEM_EXTENDED_PARAMETER_EC_CODE)) return STATUS_INVALID_PARAMETER;
 
     /* Reserve the memory */
@@ -4177,13 +4217,18 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
             if (type & MEM_WRITE_WATCH) vprot |= VPROT_WRITEWATCH;
             if (type & MEM_RESERVE_PLACEHOLDER) vprot |= VPROT_PLACEHOLDER | VPROT_FREE_PLACEHOLDER;
             if (protect & PAGE_NOCACHE) vprot |= SEC_NOCACHE;
+            if (type & MEM_LARGE_PAGES) vprot |= SEC_LARGE_PAGES;
 
             if (vprot & VPROT_WRITECOPY) status = STATUS_INVALID_PAGE_PROTECTION;
             else if (is_dos_memory) status = allocate_dos_memory( &view, vprot );
             else status = map_view( &view, base, size, type, vprot, limit,
-                                    align ? align - 1 : granularity_mask );
+                                    align ? align - 1 : (vprot & SEC_LARGE_PAGES) ? large_page_mask : granularity_mask );
 
-            if (status == STATUS_SUCCESS) base = view->base;
+            if (status == STATUS_SUCCESS)
+            {
+                base = view->base;
+                if (vprot & SEC_LARGE_PAGES) set_large_pages( view );
+            }
         }
     }
     else if (type & MEM_RESET)
@@ -4231,7 +4276,8 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR zero_bits,
                                          SIZE_T *size_ptr, ULONG type, ULONG protect )
 {
-    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET;
+    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit;
 
     TRACE("%p %p %08lx %x %08x\n", process, *ret, *size_ptr, (int)type, (int)protect );
@@ -4355,7 +4401,8 @@ NTSTATUS WINAPI NtAllocateVirtualMemoryEx( HANDLE process, PVOID *ret, SIZE_T *s
                                            ULONG count )
 {
     static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH
-                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER;
+                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit = 0;
     ULONG_PTR align = 0;
     ULONG attributes = 0;
@@ -4753,12 +4800,74 @@ static unsigned int get_memory_region_info( HANDLE process, LPCVOID addr, MEMORY
     return STATUS_SUCCESS;
 }
 
+#if !defined(HAVE_LIBPROCSTAT)
+
+struct huge_page_range
+{
+    ULONG_PTR start;
+    ULONG_PTR end;
+};
+
+/***********************************************************************
+ *           get_huge_page_ranges
+ *
+ * Get the mappings that the kernel currently backs with transparent huge pages, at least in part.
+ * Anonymous views report AnonHugePages, shmem-backed ones ShmemPmdMapped or FilePmdMapped.
+ */
+static unsigned int get_huge_page_ranges( struct huge_page_range **ret )
+{
+    struct huge_page_range *ranges = NULL, *new_ranges;
+    unsigned int count = 0, capacity = 0;
+    unsigned long start = 0, end = 0, vma_start, vma_end, size;
+    BOOL line_start = TRUE;
+    char buffer[256];
+    FILE *f;
+
+    if ((f = fopen( "/proc/self/smaps", "r" )))
+    {
+        while (fgets( buffer, sizeof(buffer), f ))
+        {
+            BOOL continued = !line_start;
+
+            /* skip the end of lines that didn't fit in the buffer, such as long file names */
+            line_start = strchr( buffer, '\n' ) != NULL;
+            if (continued) continue;
+            if (sscanf( buffer, "%lx-%lx ", &vma_start, &vma_end ) == 2)
+            {
+                start = vma_start;
+                end = vma_end;
+                continue;
+            }
+            if (sscanf( buffer, "AnonHugePages: %lu kB", &size ) != 1 &&
+                sscanf( buffer, "ShmemPmdMapped: %lu kB", &size ) != 1 &&
+                sscanf( buffer, "FilePmdMapped: %lu kB", &size ) != 1) continue;
+            if (!size || (count && ranges[count - 1].start == start)) continue;
+            if (count == capacity)
+            {
+                capacity = max( 16, capacity * 2 );
+                if (!(new_ranges = realloc( ranges, capacity * sizeof(*ranges) ))) break;
+                ranges = new_ranges;
+            }
+            ranges[count].start = start;
+            ranges[count].end = end;
+            count++;
+        }
+        fclose( f );
+    }
+    *ret = ranges;
+    return count;
+}
+
+#endif
+
 static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                                     MEMORY_WORKING_SET_EX_INFORMATION *info,
                                     SIZE_T len, SIZE_T *res_len )
 {
 #if !defined(HAVE_LIBPROCSTAT)
     static int pagemap_fd = -2;
+    struct huge_page_range *huge_ranges = NULL;
+    unsigned int i, huge_count = 0;
 #endif
     MEMORY_WORKING_SET_EX_INFORMATION *p;
     sigset_t sigset;
@@ -4810,6 +4919,10 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                      p->VirtualAttributes.ShareCount = 1; /* FIXME */
                  if (p->VirtualAttributes.Valid)
                      p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
+#ifdef KVME_FLAG_SUPER
+                 if (p->VirtualAttributes.Valid && (view->protect & SEC_LARGE_PAGES))
+                     p->VirtualAttributes.LargePage = !!(entry->kve_flags & KVME_FLAG_SUPER);
+#endif
              }
         }
         server_leave_uninterrupted_section( &virtual_mutex, &sigset );
@@ -4822,6 +4935,16 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
             procstat_close( pstat );
     }
 #else
+    /* parsing /proc/self/smaps is slow, do it outside of the lock if any large pages view is queried */
+    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    for (p = info; (UINT_PTR)(p + 1) <= (UINT_PTR)info + len; p++)
+    {
+        struct file_view *view = find_view( p->VirtualAddress, 0 );
+        if (view && (view->protect & SEC_LARGE_PAGES)) break;
+    }
+    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    if ((UINT_PTR)(p + 1) <= (UINT_PTR)info + len) huge_count = get_huge_page_ranges( &huge_ranges );
+
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
     if (pagemap_fd == -2)
     {
@@ -4859,9 +4982,21 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                 p->VirtualAttributes.ShareCount = 1; /* FIXME */
             if (p->VirtualAttributes.Valid)
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
+            if (p->VirtualAttributes.Valid && (view->protect & SEC_LARGE_PAGES))
+            {
+                /* report whether the kernel actually backs the view with huge pages */
+                for (i = 0; i < huge_count; i++)
+                {
+                    if ((ULONG_PTR)p->VirtualAddress < huge_ranges[i].start) continue;
+                    if ((ULONG_PTR)p->VirtualAddress >= huge_ranges[i].end) continue;
+                    p->VirtualAttributes.LargePage = 1;
+                    break;
+                }
+            }
         }
     }
     server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    free( huge_ranges );
 #endif
 
     if (res_len)
@@ -206,7 +206,7 @@ DWORD stretch_bits( const BITMAPINFO *src_info, struct bitblt_coords *src,
     if (!(ptr = malloc( dst_info->bmiHeader.biSizeImage )))
         return ERROR_OUTOFMEMORY;
 
-    err = stretch_bitmapinfo( src_info, bits->ptr, src, dst_info, ptr, dst, mode );
+    err = stretch_bitmapinfo( src_info, bits, src, dst_info, ptr, dst, mode );
     if (bits->free) bits->free( bits );
     bits->ptr = ptr;
     bits->is_copy = TRUE;
@@ -229,7 +229,7 @@ static DWORD blend_bits( const BITMAPINFO *src_info, const struct gdi_image_bits
         dst_bits->is_copy = TRUE;
         dst_bits->free = free_heap_bits;
     }
-    return blend_bitmapinfo( src_info, src_bits->ptr, src, dst_info, dst_bits->ptr, dst, blend );
+    return blend_bitmapinfo( src_info, src_bits, src, dst_info, dst_bits->ptr, dst, blend );
 }
 
 static RGBQUAD get_dc_rgb_color( DC *dc, int color_table_size, COLORREF color )
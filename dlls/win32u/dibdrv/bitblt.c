@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -435,6 +438,124 @@ static const unsigned char BITBLT_Opcodes[256][MAX_OP_LEN] =
     { OP(PAT,DST,R2_WHITE) }                                        /* 0xff  1              */
 };
 
+/* Large blends and stretches can optionally be split into horizontal bands that are processed
+ * in parallel by a pool of worker threads, enabled by setting WINEDIBTHREADS to the number of
+ * threads to use. The workers are plain Unix threads without a TEB, so a fault there can't be
+ * handled: bands are only used when both dibs have private bits, that gdi allocated itself and
+ * that the app never sees. The primitives used for bands must not log anything either, which
+ * rules out the null primitives. Jobs are allocated on the heap and the caller only waits for
+ * its own bands, so it can still be suspended, and can be terminated without leaving the
+ * workers with dangling pointers. */
+
+#define MAX_BAND_THREADS  32
+#define MIN_BAND_PIXELS   (256 * 256)  /* don't bother splitting smaller operations */
+
+struct band_job
+{
+    struct list entry;  /* entry in the list of jobs with bands left to hand out */
+    void (*proc)( struct band_job *job, int band );  /* process one band */
+    int  band_count;    /* number of bands */
+    int  next_band;     /* next band to hand out */
+    int  pending;       /* bands not yet completed */
+};
+
+static int band_thread_count;           /* total number of threads, including the caller */
+static struct list band_jobs = LIST_INIT( band_jobs );
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t band_init_once = PTHREAD_ONCE_INIT;
+
+/* process the next band of a job; band_mutex must be held */
+static void process_band( struct band_job *job )
+{
+    int band = job->next_band++;
+
+    if (job->next_band == job->band_count) list_remove( &job->entry );
+    pthread_mutex_unlock( &band_mutex );
+    job->proc( job, band );
+    pthread_mutex_lock( &band_mutex );
+    if (!--job->pending) pthread_cond_broadcast( &band_done_cond );
+}
+
+static void *band_thread( void *arg )
+{
+    struct list *ptr;
+
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        while (!(ptr = list_head( &band_jobs ))) pthread_cond_wait( &band_cond, &band_mutex );
+        process_band( LIST_ENTRY( ptr, struct band_job, entry ) );
+    }
+    return NULL;
+}
+
+static void init_band_threads(void)
+{
+    const char *env = getenv( "WINEDIBTHREADS" );
+    int i, count;
+    sigset_t sigset, old_sigset;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (!env || (count = atoi( env )) <= 1) return;
+    count = min( count, MAX_BAND_THREADS );
+
+    /* keep signals on the Wine threads */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    for (i = 1; i < count; i++)
+        if (pthread_create( &thread, &attr, band_thread, NULL )) break;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+
+    band_thread_count = i;
+    TRACE( "using %d threads\n", band_thread_count );
+}
+
+/* return the number of bands to split an operation of the given size into, 0 to stay serial */
+static int get_band_count( const dib_info *dst, const dib_info *src, int width, int height )
+{
+    pthread_once( &band_init_once, init_band_threads );
+    if (band_thread_count <= 1) return 0;
+    if (!dst->private_bits || !src->private_bits) return 0;
+    if (dst->funcs == &funcs_null) return 0;  /* the null primitives print fixmes */
+    if ((LONGLONG)width * height < MIN_BAND_PIXELS) return 0;
+    return min( height, 2 * band_thread_count );
+}
+
+/* process the bands of a heap allocated job with the help of the band threads, then free it */
+static void run_band_job( struct band_job *job, int count )
+{
+    job->band_count = job->pending = count;
+    job->next_band = 0;
+
+    pthread_mutex_lock( &band_mutex );
+    list_add_tail( &band_jobs, &job->entry );
+    pthread_cond_broadcast( &band_cond );
+    while (job->next_band < job->band_count) process_band( job );
+    while (job->pending) pthread_cond_wait( &band_done_cond, &band_mutex );
+    pthread_mutex_unlock( &band_mutex );
+    free( job );
+}
+
+/* check whether the bits of two dibs may share memory */
+static BOOL bits_overlap( const dib_info *dst, const dib_info *src )
+{
+    const char *dst_start = dst->bits.ptr, *src_start = src->bits.ptr;
+    const char *dst_end = dst_start + abs( dst->stride ), *src_end = src_start + abs( src->stride );
+
+    if (dst->stride < 0) dst_start += (dst->height - 1) * dst->stride;
+    else dst_end += (dst->height - 1) * dst->stride;
+    if (src->stride < 0) src_start += (src->height - 1) * src->stride;
+    else src_end += (src->height - 1) * src->stride;
+
+    return dst_start < src_end && src_start < dst_end;
+}
+
 static int get_overlap( const dib_info *dst, const RECT *dst_rect,
                         const dib_info *src, const RECT *src_rect )
 {
@@ -585,17 +706,70 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+struct blend_job
+{
+    struct band_job      job;
+    dib_info             dst;
+    dib_info             src;
+    POINT                offset;
+    BLENDFUNCTION        blend;
+    int                  top, height;
+    int                  count;
+    RECT                 rects[1];
+};
+
+static void blend_band( struct band_job *job, int band )
+{
+    struct blend_job *blend = CONTAINING_RECORD( job, struct blend_job, job );
+    int top = blend->top + blend->height * band / job->band_count;
+    int bottom = blend->top + blend->height * (band + 1) / job->band_count;
+    RECT rect;
+    int i;
+
+    for (i = 0; i < blend->count; i++)
+    {
+        rect = blend->rects[i];
+        rect.top = max( rect.top, top );
+        rect.bottom = min( rect.bottom, bottom );
+        if (rect.top >= rect.bottom) continue;
+        blend->dst.funcs->blend_rects( &blend->dst, 1, &rect, &blend->src, &blend->offset, blend->blend );
+    }
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
     POINT offset;
     struct clipped_rects clipped_rects;
+    struct blend_job *job;
+    RECT bounds;
+    int i, count;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
     offset.x = src_rect->left - dst_rect->left;
     offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+
+    bounds = clipped_rects.rects[0];
+    for (i = 1; i < clipped_rects.count; i++) union_rect( &bounds, &bounds, &clipped_rects.rects[i] );
+
+    if ((count = get_band_count( dst, src, bounds.right - bounds.left, bounds.bottom - bounds.top )) &&
+        !bits_overlap( dst, src ) &&
+        (job = malloc( offsetof( struct blend_job, rects[clipped_rects.count] ))))
+    {
+        job->job.proc = blend_band;
+        job->dst      = *dst;
+        job->src      = *src;
+        job->offset   = offset;
+        job->blend    = blend;
+        job->top      = bounds.top;
+        job->height   = bounds.bottom - bounds.top;
+        job->count    = clipped_rects.count;
+        memcpy( job->rects, clipped_rects.rects, clipped_rects.count * sizeof(*job->rects) );
+        run_band_job( &job->job, count );
+    }
+    else
+        dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -1074,6 +1248,7 @@ DWORD dibdrv_BlendImage( PHYSDEV dev, BITMAPINFO *info, const struct gdi_image_b
 
     init_dib_info_from_bitmapinfo( &src_dib, info, bits->ptr );
     src_dib.bits.is_copy = bits->is_copy;
+    src_dib.private_bits = bits->is_copy;
     add_clipped_bounds( pdev, &dst->visrect, pdev->clip );
     return blend_rect( &pdev->dib, &dst->visrect, &src_dib, &src->visrect, pdev->clip, blend );
 
@@ -1198,27 +1373,161 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
-DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+typedef void (*stretch_row_fn)( const dib_info *dst_dib, const POINT *dst_start,
+                                const dib_info *src_dib, const POINT *src_start,
+                                const struct stretch_params *params, int mode, BOOL keep_dst );
+
+struct stretch_rows
+{
+    POINT        dst_start;
+    POINT        src_start;
+    int          err;
+    unsigned int length;
+};
+
+struct stretch_job
+{
+    struct band_job       job;
+    dib_info              dst_dib;
+    dib_info              src_dib;
+    struct stretch_params v_params;
+    struct stretch_params h_params;
+    stretch_row_fn        row_fn;
+    int                   mode;
+    BOOL                  vstretch;
+    int                   width;
+    struct stretch_rows   bands[2 * MAX_BAND_THREADS];
+};
+
+static void stretch_rows( dib_info *dst_dib, const dib_info *src_dib, struct stretch_rows rows,
+                          const struct stretch_params *v_params, const struct stretch_params *h_params,
+                          stretch_row_fn row_fn, int mode, BOOL vstretch, int width )
+{
+    POINT dst_start = rows.dst_start, src_start = rows.src_start;
+    int err = rows.err;
+
+    if (vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = width;
+
+        while (rows.length--)
+        {
+            if (need_row)
+            {
+                row_fn( dst_dib, &dst_start, src_dib, &src_start, h_params, mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - v_params->dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                OffsetRect( &this_row, 0, v_params->dst_inc );
+                copy_rect( dst_dib, &this_row, dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                need_row = TRUE;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (rows.length--)
+        {
+            if (mode != STRETCH_DELETESCANS || !merged_rows)
+                row_fn( dst_dib, &dst_start, src_dib, &src_start, h_params, mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                merged_rows = 0;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+}
+
+static void stretch_band( struct band_job *job, int band )
+{
+    struct stretch_job *stretch = CONTAINING_RECORD( job, struct stretch_job, job );
+
+    stretch_rows( &stretch->dst_dib, &stretch->src_dib, stretch->bands[band], &stretch->v_params,
+                  &stretch->h_params, stretch->row_fn, stretch->mode, stretch->vstretch, stretch->width );
+}
+
+/* Split the rows into bands that can be processed independently. A band always starts on a
+ * fresh destination row, which is then generated from the source instead of being copied
+ * from the row above, with the same result. */
+static int split_stretch_rows( struct stretch_rows *bands, int count, struct stretch_rows rows,
+                               const struct stretch_params *v_params, BOOL vstretch )
+{
+    unsigned int i, total = rows.length, start = 0;
+    int band = 0;
+    BOOL new_row;
+
+    bands[0] = rows;
+    for (i = 0; i < total; i++)
+    {
+        new_row = vstretch || rows.err > 0;
+        if (rows.err > 0)
+        {
+            if (vstretch) rows.src_start.y += v_params->src_inc;
+            else rows.dst_start.y += v_params->dst_inc;
+            rows.err += v_params->err_add_1;
+        }
+        else rows.err += v_params->err_add_2;
+        if (vstretch) rows.dst_start.y += v_params->dst_inc;
+        else rows.src_start.y += v_params->src_inc;
+
+        if (new_row && band < count - 1 && i + 1 >= (ULONGLONG)total * (band + 1) / count && i + 1 < total)
+        {
+            bands[band++].length = i + 1 - start;
+            start = i + 1;
+            bands[band] = rows;
+        }
+    }
+    bands[band].length = total - start;
+    return band + 1;
+}
+
+DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                          struct bitblt_coords *src, const BITMAPINFO *dst_info, void *dst_bits,
+                          struct bitblt_coords *dst, INT mode )
 {
     dib_info src_dib, dst_dib;
     POINT dst_start, src_start, dst_end, src_end;
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_rows rows;
+    struct stretch_job *job;
+    int count, width;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
+    stretch_row_fn row_fn;
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
           src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits->ptr );
     init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+    /* the destination is a buffer allocated by the caller, the source may be the app's */
+    src_dib.private_bits = src_bits->is_copy;
+    dst_dib.private_bits = TRUE;
 
     if (mode == HALFTONE)
     {
@@ -1251,64 +1560,32 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
     row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    if (vstretch && hstretch) mode = STRETCH_DELETESCANS;
+    width = dst->visrect.right - dst->visrect.left;
 
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
+    rows.dst_start = dst_start;
+    rows.src_start = src_start;
+    rows.err       = v_params.err_start;
+    rows.length    = v_params.length;
 
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                OffsetRect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
+    if ((count = get_band_count( &dst_dib, &src_dib, width, dst->visrect.bottom - dst->visrect.top )) &&
+        !bits_overlap( &dst_dib, &src_dib ) && (job = malloc( sizeof(*job) )))
     {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
+        job->job.proc = stretch_band;
+        job->dst_dib  = dst_dib;
+        job->src_dib  = src_dib;
+        job->v_params = v_params;
+        job->h_params = h_params;
+        job->row_fn   = row_fn;
+        job->mode     = mode;
+        job->vstretch = vstretch;
+        job->width    = width;
+        count = split_stretch_rows( job->bands, count, rows, &v_params, vstretch );
+        run_band_job( &job->job, count );
     }
+    else
+        stretch_rows( &dst_dib, &src_dib, rows, &v_params, &h_params, row_fn, mode, vstretch, width );
 
 done:
     /* update coordinates, the destination rectangle is always stored at 0,0 */
@@ -1319,14 +1596,17 @@ done:
     return ERROR_SUCCESS;
 }
 
-DWORD blend_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                        const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                        BLENDFUNCTION blend )
+DWORD blend_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                        struct bitblt_coords *src, const BITMAPINFO *dst_info, void *dst_bits,
+                        struct bitblt_coords *dst, BLENDFUNCTION blend )
 {
     dib_info src_dib, dst_dib;
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits->ptr );
     init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+    /* the destination is a copy made by the caller, the source may be the app's */
+    src_dib.private_bits = src_bits->is_copy;
+    dst_dib.private_bits = TRUE;
 
     return blend_rect( &dst_dib, &dst->visrect, &src_dib, &src->visrect, NULL, blend );
 }
@@ -55,12 +55,25 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    LONG                  size;    /* memory used by the cached glyphs */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
-static struct list font_cache = LIST_INIT( font_cache );
+/* fonts are spread over several independently locked shards according to their hash */
+#define FONT_CACHE_SHARDS  16
+#define FONT_CACHE_UNUSED  2   /* number of unused fonts to keep around in each shard */
 
-static pthread_mutex_t font_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+struct font_cache_shard
+{
+    pthread_mutex_t lock;
+    struct list     fonts;   /* most recently used first */
+    UINT            hits;
+    UINT            misses;
+};
+
+static struct font_cache_shard font_cache[FONT_CACHE_SHARDS];
+static pthread_once_t font_cache_once = PTHREAD_ONCE_INIT;
+static UINT glyph_cache_size = 16 * 1024 * 1024;  /* maximum memory used by unused fonts */
 
 
 static BOOL brush_rect( dibdrv_physdev *pdev, dib_brush *brush, const RECT *rect, HRGN clip )
@@ -551,10 +564,69 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void init_font_cache(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < FONT_CACHE_SHARDS; i++)
+    {
+        pthread_mutex_init( &font_cache[i].lock, NULL );
+        list_init( &font_cache[i].fonts );
+    }
+}
+
+void set_glyph_cache_size( UINT size )
+{
+    glyph_cache_size = size;
+}
+
+static void free_cached_font( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    TRACE( "%p size %d\n", font, (int)font->size );
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                free( font->glyphs[i][j][k] );
+            free( font->glyphs[i][j] );
+        }
+    }
+    free( font );
+}
+
+/* free the least recently used fonts that are no longer referenced, as long as there are too
+ * many of them or they use too much memory; the shard lock must be held */
+static void trim_font_cache( struct font_cache_shard *shard )
+{
+    struct cached_font *ptr, *next;
+    UINT unused = 0, size = 0;
+
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
+    {
+        if (ptr->ref) continue;
+        unused++;
+        size += ptr->size;
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( ptr, next, &shard->fonts, struct cached_font, entry )
+    {
+        if (unused <= FONT_CACHE_UNUSED && size <= glyph_cache_size / FONT_CACHE_SHARDS) break;
+        if (ptr->ref) continue;
+        unused--;
+        size -= ptr->size;
+        list_remove( &ptr->entry );
+        free_cached_font( ptr );
+    }
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
-    struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    struct font_cache_shard *shard;
+    struct cached_font font, *ptr;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -567,52 +639,40 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     }
     font.lf.lfWidth = abs( font.lf.lfWidth );
     font.aa_flags = aa_flags;
+    font.size = 0;
     font.hash = font_cache_hash( &font );
 
-    pthread_mutex_lock( &font_cache_lock );
-    LIST_FOR_EACH_ENTRY( ptr, &font_cache, struct cached_font, entry )
+    pthread_once( &font_cache_once, init_font_cache );
+    shard = &font_cache[(font.hash ^ (font.hash >> 16)) % FONT_CACHE_SHARDS];
+
+    pthread_mutex_lock( &shard->lock );
+    LIST_FOR_EACH_ENTRY( ptr, &shard->fonts, struct cached_font, entry )
     {
         if (!font_cache_cmp( &font, ptr ))
         {
             InterlockedIncrement( &ptr->ref );
             list_remove( &ptr->entry );
+            shard->hits++;
             goto done;
         }
-        if (!ptr->ref)
-        {
-            i++;
-            last_unused = ptr;
-        }
     }
 
-    if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
+    trim_font_cache( shard );
+    if (!(ptr = malloc( sizeof(*ptr) )))
     {
-        ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    free( ptr->glyphs[i][j][k] );
-                free( ptr->glyphs[i][j] );
-            }
-        }
-        list_remove( &ptr->entry );
-    }
-    else if (!(ptr = malloc( sizeof(*ptr) )))
-    {
-        pthread_mutex_unlock( &font_cache_lock );
+        pthread_mutex_unlock( &shard->lock );
         return NULL;
     }
 
     *ptr = font;
     ptr->ref = 1;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
+    shard->misses++;
 done:
-    list_add_head( &font_cache, &ptr->entry );
-    pthread_mutex_unlock( &font_cache_lock );
-    TRACE( "%d %s -> %p\n", (int)ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
+    list_add_head( &shard->fonts, &ptr->entry );
+    TRACE( "%d %s -> %p, shard %d hits %u misses %u\n", (int)ptr->lf.lfHeight,
+           debugstr_w(ptr->lf.lfFaceName), ptr, (int)(shard - font_cache), shard->hits, shard->misses );
+    pthread_mutex_unlock( &shard->lock );
     return ptr;
 }
 
@@ -622,7 +682,7 @@ void release_cached_font( struct cached_font *font )
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, UINT size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -641,9 +701,15 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         }
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             free( ptr );
+        else
+            InterlockedExchangeAdd( &font->size, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        InterlockedExchangeAdd( &font->size, FIELD_OFFSET( struct cached_glyph, bits[size] ));
+        ret = glyph;
+    }
     else free( glyph );
     return ret;
 }
@@ -804,7 +870,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, size );
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
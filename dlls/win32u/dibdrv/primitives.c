@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -4652,6 +4655,40 @@ static inline DWORD blend_argb( DWORD dst, DWORD src )
             (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
 }
 
+#ifdef __SSE2__
+/* same as blend_argb on two pixels unpacked to 16-bit channels */
+static inline __m128i blend_argb_sse2( __m128i dst, __m128i src )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+    __m128i val = _mm_mullo_epi16( dst, _mm_sub_epi16( mask, alpha ));
+
+    /* (val + 127) / 255 */
+    val = _mm_add_epi16( val, _mm_set1_epi16( 128 ));
+    val = _mm_srli_epi16( _mm_add_epi16( val, _mm_srli_epi16( val, 8 )), 8 );
+    val = _mm_add_epi16( src, val );
+    /* an overflowing channel spills into the next one, as in the scalar version */
+    return _mm_or_si128( _mm_and_si128( val, mask ), _mm_slli_epi64( _mm_srli_epi16( val, 8 ), 16 ));
+}
+#endif
+
+static inline void blend_argb_row( DWORD *dst, const DWORD *src, int len )
+{
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; len >= 4; len -= 4, dst += 4, src += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)src );
+        __m128i d = _mm_loadu_si128( (const __m128i *)dst );
+        __m128i lo = blend_argb_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ));
+        __m128i hi = blend_argb_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ));
+        _mm_storeu_si128( (__m128i *)dst, _mm_packus_epi16( lo, hi ));
+    }
+#endif
+    for (; len > 0; len--, dst++, src++) *dst = blend_argb( *dst, *src );
+}
+
 static inline DWORD blend_argb_alpha( DWORD dst, DWORD src, DWORD alpha )
 {
     BYTE b = ((BYTE)src         * alpha + 127) / 255;
@@ -4696,8 +4733,7 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         {
             if (blend.SourceConstantAlpha == 255)
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+                    blend_argb_row( dst_ptr, src_ptr, rc->right - rc->left );
             else
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
                     for (x = 0; x < rc->right - rc->left; x++)
@@ -4810,6 +4810,9 @@ static UINT init_font_options(void)
         antialias_fakes = (wcschr( valsW, *(const WCHAR *)info->Data ) != NULL);
     }
 
+    /* size of the DIB engine glyph cache, in kilobytes */
+    if (get_key_value( wine_fonts_key, "GlyphCacheSize", &val )) set_glyph_cache_size( val * 1024 );
+
     if ((key = reg_open_hkcu_key( "Control Panel\\Desktop" )))
     {
         /* FIXME: handle vertical orientations even though Windows doesn't */
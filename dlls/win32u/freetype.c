@@ -123,6 +123,7 @@
 #include "ntgdi_private.h"
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #ifdef HAVE_FREETYPE
 
@@ -1166,6 +1167,309 @@ struct unix_face
     struct bitmap_font_size size;
 };
 
+/* face cache
+ *
+ * The properties of the faces found in font files are saved to a cache file in the system
+ * directory, so that later processes don't need to open and parse all the font files again.
+ * Entries are validated against the size, modification time and inode of the font file.
+ */
+
+#define FACE_CACHE_MAGIC  0x32434657  /* "WFC2" */
+
+struct face_cache_header
+{
+    UINT magic;
+    UINT lcid;
+};
+
+struct face_cache_entry
+{
+    UINT                    entry_size;  /* total size, including the names */
+    UINT                    face_index;
+    UINT                    flags;
+    UINT                    valid;       /* is the file a usable font? */
+    ULONGLONG               file_size;
+    ULONGLONG               file_mtime;  /* in nanoseconds */
+    ULONGLONG               file_ino;
+    UINT                    scalable;
+    UINT                    num_faces;
+    DWORD                   ntm_flags;
+    DWORD                   font_version;
+    FONTSIGNATURE           fs;
+    struct bitmap_font_size size;
+    UINT                    names;       /* mask of the names that are present */
+    WCHAR                   data[1];     /* family, second, style and full names, then unix name */
+};
+
+struct face_cache_key
+{
+    const char *unix_name;
+    UINT        face_index;
+    UINT        flags;
+};
+
+struct face_cache_node
+{
+    struct wine_rb_entry           entry;
+    const struct face_cache_entry *data;
+    const char                    *unix_name;
+    BOOL                           used;       /* font file still exists */
+    BOOL                           allocated;  /* data is not in the cache file mapping */
+};
+
+static int face_cache_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct face_cache_key *k = key;
+    const struct face_cache_node *node = WINE_RB_ENTRY_VALUE( entry, struct face_cache_node, entry );
+    int ret;
+
+    if ((ret = strcmp( k->unix_name, node->unix_name ))) return ret;
+    if (k->face_index != node->data->face_index) return k->face_index > node->data->face_index ? 1 : -1;
+    if (k->flags != node->data->flags) return k->flags > node->data->flags ? 1 : -1;
+    return 0;
+}
+
+static char *get_unix_file_name( LPCWSTR path );
+
+static struct wine_rb_tree face_cache = { face_cache_compare };
+static BOOL face_cache_loaded;
+static BOOL face_cache_dirty;
+
+static char *get_face_cache_file_name(void)
+{
+    WCHAR path[MAX_PATH];
+
+    asciiz_to_unicode( path, "\\??\\C:\\windows\\system32\\winefontcache.dat" );
+    return get_unix_file_name( path );
+}
+
+static const char *get_face_cache_unix_name( const struct face_cache_entry *entry, UINT size )
+{
+    const WCHAR *ptr = entry->data, *end = (const WCHAR *)((const char *)entry + size);
+    const char *name, *name_end = (const char *)entry + size;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        while (ptr < end && *ptr) ptr++;
+        if (ptr++ >= end) return NULL;
+    }
+    for (name = (const char *)ptr; name < name_end; name++) if (!*name) return (const char *)ptr;
+    return NULL;
+}
+
+static void add_face_cache_node( const char *unix_name, const struct face_cache_entry *entry,
+                                 BOOL allocated )
+{
+    struct face_cache_key key = { unix_name, entry->face_index, entry->flags };
+    struct face_cache_node *node;
+    struct wine_rb_entry *ptr;
+
+    if ((ptr = wine_rb_get( &face_cache, &key )))
+    {
+        node = WINE_RB_ENTRY_VALUE( ptr, struct face_cache_node, entry );
+        if (node->allocated) free( (void *)node->data );
+    }
+    else
+    {
+        if (!(node = malloc( sizeof(*node) ))) return;
+        wine_rb_put( &face_cache, &key, &node->entry );
+    }
+    node->data = entry;
+    node->unix_name = unix_name;
+    node->used = allocated;
+    node->allocated = allocated;
+}
+
+static void load_face_cache(void)
+{
+    const struct face_cache_header *header;
+    const struct face_cache_entry *entry;
+    const char *unix_name, *ptr, *end;
+    struct stat st;
+    char *file;
+    void *data;
+    int fd;
+
+    face_cache_loaded = TRUE;
+    if (!(file = get_face_cache_file_name())) return;
+    fd = open( file, O_RDONLY );
+    free( file );
+    if (fd == -1) return;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return;
+    }
+    close( fd );
+
+    header = data;
+    if (header->magic != FACE_CACHE_MAGIC || header->lcid != system_lcid)
+    {
+        TRACE( "ignoring outdated cache\n" );
+        munmap( data, st.st_size );
+        return;
+    }
+
+    /* the mapping is kept around, the cache nodes point into it */
+    ptr = (const char *)(header + 1);
+    end = (const char *)data + st.st_size;
+    while (end - ptr >= offsetof( struct face_cache_entry, data ))
+    {
+        entry = (const struct face_cache_entry *)ptr;
+        if (entry->entry_size < offsetof( struct face_cache_entry, data ) ||
+            entry->entry_size > end - ptr || entry->entry_size % sizeof(ULONGLONG)) break;
+        if ((unix_name = get_face_cache_unix_name( entry, entry->entry_size )))
+            add_face_cache_node( unix_name, entry, FALSE );
+        ptr += entry->entry_size;
+    }
+}
+
+static ULONGLONG get_face_cache_mtime( const struct stat *st )
+{
+    ULONGLONG mtime = (ULONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime += st->st_mtimespec.tv_nsec;
+#endif
+    return mtime;
+}
+
+static BOOL face_cache_lookup( const char *unix_name, const struct stat *st, UINT face_index,
+                               UINT flags, struct unix_face **face )
+{
+    struct face_cache_key key = { unix_name, face_index, flags & ADDFONT_ALLOW_BITMAP };
+    const struct face_cache_entry *entry;
+    struct face_cache_node *node;
+    struct wine_rb_entry *ptr;
+    const WCHAR *name;
+    WCHAR **names[4];
+    struct unix_face *This;
+    int i;
+
+    if (!face_cache_loaded) load_face_cache();
+    if (!(ptr = wine_rb_get( &face_cache, &key ))) return FALSE;
+    node = WINE_RB_ENTRY_VALUE( ptr, struct face_cache_node, entry );
+    entry = node->data;
+    if (entry->file_size != st->st_size || entry->file_mtime != get_face_cache_mtime( st ) ||
+        entry->file_ino != st->st_ino)
+        return FALSE;
+
+    node->used = TRUE;
+    *face = NULL;
+    if (!entry->valid) return TRUE;
+    if (!(This = calloc( 1, sizeof(*This) ))) return FALSE;
+
+    This->scalable     = entry->scalable;
+    This->num_faces    = entry->num_faces;
+    This->ntm_flags    = entry->ntm_flags;
+    This->font_version = entry->font_version;
+    This->fs           = entry->fs;
+    This->size         = entry->size;
+
+    names[0] = &This->family_name;
+    names[1] = &This->second_name;
+    names[2] = &This->style_name;
+    names[3] = &This->full_name;
+    for (i = 0, name = entry->data; i < 4; i++, name += lstrlenW( name ) + 1)
+        if (entry->names & (1 << i)) *names[i] = wcsdup( name );
+
+    *face = This;
+    return TRUE;
+}
+
+static void face_cache_add( const char *unix_name, const struct stat *st, UINT face_index,
+                            UINT flags, const struct unix_face *face )
+{
+    const WCHAR *names[4] = { NULL };
+    struct face_cache_entry *entry;
+    UINT i, size, len[4] = { 0 };
+    WCHAR *ptr;
+
+    if (face)
+    {
+        names[0] = face->family_name;
+        names[1] = face->second_name;
+        names[2] = face->style_name;
+        names[3] = face->full_name;
+    }
+    size = offsetof( struct face_cache_entry, data );
+    for (i = 0; i < 4; i++)
+    {
+        if (names[i]) len[i] = lstrlenW( names[i] );
+        size += (len[i] + 1) * sizeof(WCHAR);
+    }
+    size = (size + strlen( unix_name ) + 1 + sizeof(ULONGLONG) - 1) & ~(sizeof(ULONGLONG) - 1);
+
+    if (!(entry = calloc( 1, size ))) return;
+    entry->entry_size = size;
+    entry->face_index = face_index;
+    entry->flags      = flags & ADDFONT_ALLOW_BITMAP;
+    entry->file_size  = st->st_size;
+    entry->file_mtime = get_face_cache_mtime( st );
+    entry->file_ino   = st->st_ino;
+    if ((entry->valid = !!face))
+    {
+        entry->scalable     = face->scalable;
+        entry->num_faces    = face->num_faces;
+        entry->ntm_flags    = face->ntm_flags;
+        entry->font_version = face->font_version;
+        entry->fs           = face->fs;
+        entry->size         = face->size;
+    }
+    for (i = 0, ptr = entry->data; i < 4; i++)
+    {
+        if (names[i]) entry->names |= 1 << i;
+        memcpy( ptr, names[i], len[i] * sizeof(WCHAR) );
+        ptr += len[i] + 1;
+    }
+    strcpy( (char *)ptr, unix_name );
+
+    add_face_cache_node( (const char *)ptr, entry, TRUE );
+    face_cache_dirty = TRUE;
+}
+
+static void save_face_cache(void)
+{
+    struct face_cache_header header = { FACE_CACHE_MAGIC, system_lcid };
+    struct face_cache_node *node;
+    char *file, *tmp;
+    BOOL ret;
+    FILE *f;
+
+    if (!face_cache_dirty) return;
+    face_cache_dirty = FALSE;
+
+    if (!(file = get_face_cache_file_name())) return;
+    if (!(tmp = malloc( strlen( file ) + 16 )))
+    {
+        free( file );
+        return;
+    }
+    sprintf( tmp, "%s.%d", file, (int)getpid() );
+
+    if ((f = fopen( tmp, "wb" )))
+    {
+        ret = fwrite( &header, sizeof(header), 1, f ) == 1;
+        WINE_RB_FOR_EACH_ENTRY( node, &face_cache, struct face_cache_node, entry )
+        {
+            if (!node->used) continue;  /* the font file wasn't found this time */
+            if (fwrite( node->data, node->data->entry_size, 1, f ) != 1) ret = FALSE;
+        }
+        if (fclose( f )) ret = FALSE;
+        /* replace the file atomically, other processes may be reading it */
+        if (!ret || rename( tmp, file ))
+        {
+            WARN( "failed to write %s\n", debugstr_a(file) );
+            unlink( tmp );
+        }
+    }
+    free( tmp );
+    free( file );
+}
+
 static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr, UINT data_size,
                                            UINT face_index, UINT flags )
 {
@@ -1183,6 +1487,8 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
 
     if (unix_name)
     {
+        if (!stat( unix_name, &st ) && face_cache_lookup( unix_name, &st, face_index, flags, &This ))
+            return This;
         if ((fd = open( unix_name, O_RDONLY )) == -1) return NULL;
         if (fstat( fd, &st ) == -1)
         {
@@ -1195,7 +1501,11 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
         if (data_ptr == MAP_FAILED) return NULL;
     }
 
-    if (!(This = calloc( 1, sizeof(*This) ))) goto done;
+    if (!(This = calloc( 1, sizeof(*This) )))
+    {
+        if (unix_name) munmap( data_ptr, data_size );
+        return NULL;
+    }
 
     if (opentype_get_ttc_sfnt_v1( data_ptr, data_size, face_index, &face_count, &ttc_sfnt_v1 ) &&
         opentype_get_tt_name_v0( data_ptr, data_size, ttc_sfnt_v1, &tt_name_v0 ) &&
@@ -1277,8 +1587,11 @@ static struct unix_face *unix_face_create( const char *unix_name, void *data_ptr
         This = NULL;
     }
 
-done:
-    if (unix_name) munmap( data_ptr, data_size );
+    if (unix_name)
+    {
+        munmap( data_ptr, data_size );
+        face_cache_add( unix_name, &st, face_index, flags, This );
+    }
     return This;
 }
 
@@ -1890,6 +2203,7 @@ static void freetype_load_fonts(void)
 #elif defined(__ANDROID__)
     ReadFontDir("/system/fonts", TRUE);
 #endif
+    save_face_cache();
 }
 
 /* Some fonts have large usWinDescent values, as a result of storing signed short
@@ -859,6 +859,7 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
  */
 DWORD WINAPI NtUserGetQueueStatus( UINT flags )
 {
+    UINT bits;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -869,6 +870,10 @@ DWORD WINAPI NtUserGetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* nothing to clear, no need to ask the server */
+    if (get_shared_queue_bits( &bits ) && !(HIWORD(bits) & flags))
+        return MAKELONG( 0, LOWORD(bits) & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -884,10 +889,13 @@ DWORD WINAPI NtUserGetQueueStatus( UINT flags )
  */
 DWORD get_input_state(void)
 {
+    UINT bits;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if (get_shared_queue_bits( &bits )) return LOWORD(bits) & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
@@ -1797,6 +1797,20 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
     if (!first && !last) last = ~0;
     if (hwnd == HWND_BROADCAST) hwnd = HWND_TOPMOST;
 
+    /* if the shared bits tell us that nothing matching the filter is queued, we can skip the
+     * server call; still call it regularly so that the server doesn't consider the thread hung */
+    if (hwnd != (HWND)-1 && NtGetTickCount() - thread_info->last_getmsg_time < 1000)
+    {
+        UINT bits, filter = HIWORD(flags) ? HIWORD(flags) : QS_ALLINPUT;
+
+        if (get_shared_queue_bits( &bits ) &&
+            !((LOWORD(bits) | HIWORD(bits)) & (filter | QS_SENDMESSAGE)))
+        {
+            free( buffer );
+            return 0;
+        }
+    }
+
     for (;;)
     {
         NTSTATUS res;
@@ -1816,6 +1830,7 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
             req->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
             req->changed_mask = changed_mask;
             wine_server_set_reply( req, buffer, buffer_size );
+            thread_info->last_getmsg_time = NtGetTickCount();
             if (!(res = wine_server_call( req )))
             {
                 size = wine_server_reply_size( reply );
@@ -2054,6 +2069,41 @@ static void process_sent_messages(void)
     peek_message( &msg, 0, 0, 0, PM_REMOVE | PM_QS_SENDMESSAGE, 0 );
 }
 
+/***********************************************************************
+ *           get_queue_status_data
+ *
+ * Map the queue status bits shared by the server.
+ */
+static const volatile UINT *get_queue_status_data(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+        '\\','_','_','w','i','n','e','_','q','u','e','u','e','_','s','t','a','t','u','s'};
+    static const volatile UINT *status_data;
+    static BOOL failed;
+    UNICODE_STRING name = { sizeof(nameW), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    HANDLE section;
+
+    if (status_data || failed) return status_data;
+
+    InitializeObjectAttributes( &attr, &name, 0, 0, NULL );
+    if (NtOpenSection( &section, SECTION_MAP_READ, &attr ))
+    {
+        WARN( "queue status section not available\n" );
+        failed = TRUE;
+        return NULL;
+    }
+    if (NtMapViewOfSection( section, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                            ViewShare, 0, PAGE_READONLY ))
+        failed = TRUE;
+    else if (InterlockedCompareExchangePointer( (void **)&status_data, ptr, NULL ))
+        NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+    NtClose( section );
+    return status_data;
+}
+
 /***********************************************************************
  *           get_server_queue_handle
  *
@@ -2062,6 +2112,7 @@ static void process_sent_messages(void)
 static HANDLE get_server_queue_handle(void)
 {
     struct user_thread_info *thread_info = get_user_thread_info();
+    unsigned int index = ~0u;
     HANDLE ret;
 
     if (!(ret = thread_info->server_queue))
@@ -2070,10 +2121,16 @@ static HANDLE get_server_queue_handle(void)
         {
             wine_server_call( req );
             ret = wine_server_ptr_handle( reply->handle );
+            index = reply->status_index;
         }
         SERVER_END_REQ;
         thread_info->server_queue = ret;
         if (!ret) ERR( "Cannot get server thread queue\n" );
+        else if (index < QUEUE_STATUS_ENTRIES)
+        {
+            const volatile UINT *status_data = get_queue_status_data();
+            if (status_data) thread_info->queue_status = status_data + index;
+        }
     }
     return ret;
 }
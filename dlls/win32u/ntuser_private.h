@@ -118,6 +118,8 @@ struct user_thread_info
     HANDLE                        server_queue;           /* Handle to server-side queue */
     DWORD                         wake_mask;              /* Current queue wake mask */
     DWORD                         changed_mask;           /* Current queue changed mask */
+    const volatile UINT          *queue_status;           /* Queue bits shared by the server */
+    DWORD                         last_getmsg_time;       /* Time of last get_message server call */
     WORD                          message_count;          /* Get/PeekMessage loop counter */
     WORD                          hook_call_depth;        /* Number of recursively called hook procs */
     WORD                          hook_unicode;           /* Is current hook unicode? */
@@ -141,6 +143,16 @@ static inline struct user_thread_info *get_user_thread_info(void)
     return CONTAINING_RECORD( NtUserGetThreadInfo(), struct user_thread_info, client_info );
 }
 
+/* return the queue bits shared by the server as (changed_bits << 16) | wake_bits */
+static inline BOOL get_shared_queue_bits( UINT *bits )
+{
+    const volatile UINT *status = get_user_thread_info()->queue_status;
+
+    if (!status) return FALSE;
+    *bits = *status;
+    return TRUE;
+}
+
 struct user_key_state_info
 {
     UINT  time;          /* Time of last key state refresh */
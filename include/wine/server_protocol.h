@@ -1435,6 +1435,37 @@ struct query_event_reply
 };
 
 
+struct get_inproc_sync_fd_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_inproc_sync_fd_reply
+{
+    struct reply_header __header;
+    int          type;
+    unsigned int access;
+};
+enum inproc_sync_type
+{
+    INPROC_SYNC_UNKNOWN,
+    INPROC_SYNC_NONE,
+    INPROC_SYNC_AUTO_EVENT,
+    INPROC_SYNC_MANUAL_EVENT
+};
+
+
+struct get_inproc_apc_fd_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_inproc_apc_fd_reply
+{
+    struct reply_header __header;
+};
+
+
 struct open_event_request
 {
     struct request_header __header;
@@ -2699,10 +2730,13 @@ struct get_msg_queue_reply
 {
     struct reply_header __header;
     obj_handle_t handle;
-    char __pad_12[4];
+    unsigned int status_index;
 };
 
 
+#define QUEUE_STATUS_ENTRIES 65536
+
+
 
 struct set_queue_fd_request
 {
@@ -5162,6 +5196,28 @@ struct remove_completion_reply
 };
 
 
+struct completion_info
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+};
+
+
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(info,completion_infos); */
+};
+
+
 
 struct query_completion_request
 {
@@ -5589,6 +5645,8 @@ enum request
     REQ_create_event,
     REQ_event_op,
     REQ_query_event,
+    REQ_get_inproc_sync_fd,
+    REQ_get_inproc_apc_fd,
     REQ_open_event,
     REQ_create_keyed_event,
     REQ_open_keyed_event,
@@ -5811,6 +5869,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5876,6 +5935,8 @@ union generic_request
     struct create_event_request create_event_request;
     struct event_op_request event_op_request;
     struct query_event_request query_event_request;
+    struct get_inproc_sync_fd_request get_inproc_sync_fd_request;
+    struct get_inproc_apc_fd_request get_inproc_apc_fd_request;
     struct open_event_request open_event_request;
     struct create_keyed_event_request create_keyed_event_request;
     struct open_keyed_event_request open_keyed_event_request;
@@ -6098,6 +6159,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -6161,6 +6223,8 @@ union generic_reply
     struct create_event_reply create_event_reply;
     struct event_op_reply event_op_reply;
     struct query_event_reply query_event_reply;
+    struct get_inproc_sync_fd_reply get_inproc_sync_fd_reply;
+    struct get_inproc_apc_fd_reply get_inproc_apc_fd_reply;
     struct open_event_reply open_event_reply;
     struct create_keyed_event_reply create_keyed_event_reply;
     struct open_keyed_event_reply open_keyed_event_reply;
@@ -6383,6 +6447,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -6413,7 +6478,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 774
+#define SERVER_PROTOCOL_VERSION 783
 
 /* ### protocol_version end ### */
 
@@ -707,15 +707,10 @@ static struct iosb *create_iosb( const void *in_data, data_size_t in_size, data_
     return iosb;
 }
 
-/* create an async associated with iosb for async-based requests
- * returned async must be passed to async_handoff */
-struct async *create_request_async( struct fd *fd, unsigned int comp_flags, const async_data_t *data )
+static struct async *create_request_async_iosb( struct fd *fd, unsigned int comp_flags,
+                                                const async_data_t *data, struct iosb *iosb )
 {
     struct async *async;
-    struct iosb *iosb;
-
-    if (!(iosb = create_iosb( get_req_data(), get_req_data_size(), get_reply_max_size() )))
-        return NULL;
 
     async = create_async( fd, current, data, iosb );
     release_object( iosb );
@@ -733,6 +728,33 @@ struct async *create_request_async( struct fd *fd, unsigned int comp_flags, cons
     return async;
 }
 
+/* create an async associated with iosb for async-based requests
+ * returned async must be passed to async_handoff */
+struct async *create_request_async( struct fd *fd, unsigned int comp_flags, const async_data_t *data )
+{
+    struct iosb *iosb;
+
+    if (!(iosb = create_iosb( get_req_data(), get_req_data_size(), get_reply_max_size() )))
+        return NULL;
+    return create_request_async_iosb( fd, comp_flags, data, iosb );
+}
+
+/* same as create_request_async, but the iosb takes over the request data instead of copying it,
+ * so the request data can no longer be accessed afterwards */
+struct async *create_request_async_steal_data( struct fd *fd, unsigned int comp_flags, const async_data_t *data )
+{
+    struct iosb *iosb;
+
+    if (!(iosb = create_iosb( NULL, 0, get_reply_max_size() ))) return NULL;
+    if (get_req_data_size() && !(iosb->in_data = steal_req_data()))
+    {
+        release_object( iosb );
+        return NULL;
+    }
+    iosb->in_size = get_req_data_size();
+    return create_request_async_iosb( fd, comp_flags, data, iosb );
+}
+
 struct iosb *async_get_iosb( struct async *async )
 {
     return async->iosb ? (struct iosb *)grab_object( async->iosb ) : NULL;
@@ -236,6 +236,41 @@ DECL_HANDLER(remove_completion)
     release_object( completion );
 }
 
+/* get several completions from completion port */
+DECL_HANDLER(remove_completions)
+{
+    struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+    struct completion_info *info;
+    struct list *entry;
+    struct comp_msg *msg;
+    data_size_t count;
+
+    if (!completion) return;
+
+    count = min( completion->depth, get_reply_max_size() / sizeof(*info) );
+    if (!count)
+        set_error( STATUS_PENDING );
+    else if ((info = set_reply_data_size( count * sizeof(*info) )))
+    {
+        while (count--)
+        {
+            entry = list_head( &completion->queue );
+            list_remove( entry );
+            completion->depth--;
+            msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+            info->ckey = msg->ckey;
+            info->cvalue = msg->cvalue;
+            info->information = msg->information;
+            info->status = msg->status;
+            info->__pad = 0;
+            info++;
+            free( msg );
+        }
+    }
+
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
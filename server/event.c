@@ -24,7 +24,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -32,6 +39,7 @@
 #include "winternl.h"
 
 #include "handle.h"
+#include "file.h"
 #include "thread.h"
 #include "request.h"
 #include "security.h"
@@ -56,13 +64,16 @@ struct event
     struct list    kernel_object;   /* list of kernel object pointers */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+    struct fd     *sync_fd;         /* eventfd for in-process synchronization */
 };
 
 static void event_dump( struct object *obj, int verbose );
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int event_signal( struct object *obj, unsigned int access);
 static struct list *event_get_kernel_obj_list( struct object *obj );
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
@@ -70,7 +81,7 @@ static const struct object_ops event_ops =
     &event_type,               /* type */
     event_dump,                /* dump */
     add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    event_remove_queue,        /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
     event_signal,              /* signal */
@@ -85,7 +96,25 @@ static const struct object_ops event_ops =
     no_open_file,              /* open_file */
     event_get_kernel_obj_list, /* get_kernel_obj_list */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
+};
+
+static void event_sync_poll_event( struct fd *fd, int event );
+
+static const struct fd_ops event_sync_fd_ops =
+{
+    NULL,                      /* get_poll_events */
+    event_sync_poll_event,     /* poll_event */
+    NULL,                      /* get_fd_type */
+    NULL,                      /* read */
+    NULL,                      /* write */
+    NULL,                      /* flush */
+    NULL,                      /* get_file_info */
+    NULL,                      /* get_volume_info */
+    NULL,                      /* ioctl */
+    NULL,                      /* cancel_async */
+    NULL,                      /* queue_async */
+    NULL                       /* reselect_async */
 };
 
 
@@ -136,6 +165,78 @@ static const struct object_ops keyed_event_ops =
 };
 
 
+/* In-process synchronization: when enabled, the state of an event is also kept in an
+ * eventfd shared with the clients, so that an uncontended set or wait doesn't need a
+ * server call. Reading the eventfd acquires the signal; for an auto-reset event the
+ * server consumes it when checking a wait, and gives it back if a wait all is not
+ * satisfied. */
+
+int inproc_sync_enabled(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEINPROCSYNC" );
+        enabled = env && atoi( env );
+    }
+    return enabled;
+}
+
+static struct fd *create_event_sync_fd( struct event *event, int initial_state )
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    int unix_fd;
+
+    if (!inproc_sync_enabled()) return NULL;
+    if ((unix_fd = eventfd( initial_state ? 1 : 0, EFD_CLOEXEC | EFD_NONBLOCK )) == -1) return NULL;
+    return create_anonymous_fd( &event_sync_fd_ops, unix_fd, &event->obj, 0 );
+#else
+    return NULL;
+#endif
+}
+
+/* check the eventfd state without consuming it */
+static int event_sync_is_set( struct event *event )
+{
+    return (check_fd_events( event->sync_fd, POLLIN ) & POLLIN) != 0;
+}
+
+/* consume the eventfd state, return 1 if it was set */
+static int event_sync_reset( struct event *event )
+{
+    uint64_t value;
+    return read( get_unix_fd( event->sync_fd ), &value, sizeof(value) ) == sizeof(value);
+}
+
+static void event_sync_set( struct event *event )
+{
+    uint64_t value = 1;
+    if (write( get_unix_fd( event->sync_fd ), &value, sizeof(value) ) == -1 && errno != EAGAIN)
+        file_set_error();
+}
+
+/* only poll the eventfd while some thread is blocked on an unsignaled event,
+ * otherwise the clients change the state without the server being involved */
+static void event_sync_update_poll( struct event *event, int signaled )
+{
+    set_fd_events( event->sync_fd, !signaled && !list_empty( &event->obj.wait_queue ) ? POLLIN : 0 );
+}
+
+static void event_sync_poll_event( struct fd *fd, int event )
+{
+    struct event *ev = get_fd_user( fd );
+
+    set_fd_events( fd, 0 );
+    wake_up( &ev->obj, !ev->manual_reset );
+}
+
+static int get_event_state( struct event *event )
+{
+    if (event->signaled) return 1;
+    return event->sync_fd && event_sync_is_set( event );
+}
+
 struct event *create_event( struct object *root, const struct unicode_str *name,
                             unsigned int attr, int manual_reset, int initial_state,
                             const struct security_descriptor *sd )
@@ -149,7 +250,9 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             /* initialize it if it didn't already exist */
             list_init( &event->kernel_object );
             event->manual_reset = manual_reset;
-            event->signaled     = initial_state;
+            event->signaled     = 0;
+            if (!(event->sync_fd = create_event_sync_fd( event, initial_state )))
+                event->signaled = initial_state;
         }
     }
     return event;
@@ -162,15 +265,14 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
 
 static void pulse_event( struct event *event )
 {
-    event->signaled = 1;
-    /* wake up all waiters if manual reset, a single one otherwise */
-    wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    set_event( event );
+    reset_event( event );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    if (event->sync_fd) event_sync_set( event );
+    else event->signaled = 1;
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
@@ -178,21 +280,46 @@ void set_event( struct event *event )
 void reset_event( struct event *event )
 {
     event->signaled = 0;
+    if (event->sync_fd) event_sync_reset( event );
 }
 
 static void event_dump( struct object *obj, int verbose )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    fprintf( stderr, "Event manual=%d signaled=%d\n",
-             event->manual_reset, event->signaled );
+    fprintf( stderr, "Event manual=%d signaled=%d inproc=%d\n",
+             event->manual_reset, get_event_state( event ), event->sync_fd != NULL );
+}
+
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    /* last waiter is gone; removing it may release the last reference */
+    if (event->sync_fd && !list_prev( &obj->wait_queue, &entry->entry ) &&
+        !list_next( &obj->wait_queue, &entry->entry ))
+        set_fd_events( event->sync_fd, 0 );
+    remove_queue( obj, entry );
 }
 
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
+    int signaled;
+
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    if (!event->sync_fd) return event->signaled;
+
+    /* grab the signal of an auto-reset event now, before a client can steal it */
+    if (!event->manual_reset)
+    {
+        if (!event->signaled) event->signaled = event_sync_reset( event );
+        signaled = event->signaled;
+    }
+    else signaled = event->signaled || event_sync_is_set( event );
+
+    event_sync_update_poll( event, signaled );
+    return signaled;
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -203,6 +330,17 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     if (!event->manual_reset) event->signaled = 0;
 }
 
+/* give back to the clients the signal grabbed by a wait all that was not satisfied */
+void release_inproc_sync_signal( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+
+    if (obj->ops != &event_ops || !event->sync_fd || event->manual_reset) return;
+    if (!event->signaled) return;
+    event->signaled = 0;
+    event_sync_set( event );
+}
+
 static int event_signal( struct object *obj, unsigned int access )
 {
     struct event *event = (struct event *)obj;
@@ -223,6 +361,13 @@ static struct list *event_get_kernel_obj_list( struct object *obj )
     return &event->kernel_object;
 }
 
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->sync_fd) release_object( event->sync_fd );
+}
+
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -316,7 +461,7 @@ DECL_HANDLER(event_op)
     struct event *event;
 
     if (!(event = get_event_obj( current->process, req->handle, EVENT_MODIFY_STATE ))) return;
-    reply->state = event->signaled;
+    reply->state = get_event_state( event );
     switch(req->op)
     {
     case PULSE_EVENT:
@@ -343,11 +488,30 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = get_event_state( event );
 
     release_object( event );
 }
 
+/* retrieve the fd used for in-process synchronization */
+DECL_HANDLER(get_inproc_sync_fd)
+{
+    struct event *event;
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    event = (struct event *)obj;
+    if (obj->ops == &event_ops && event->sync_fd)
+    {
+        reply->type   = event->manual_reset ? INPROC_SYNC_MANUAL_EVENT : INPROC_SYNC_AUTO_EVENT;
+        reply->access = get_handle_access( current->process, req->handle );
+        send_client_fd( current->process, get_unix_fd( event->sync_fd ), req->handle );
+    }
+    else set_error( STATUS_NOT_IMPLEMENTED );
+    release_object( obj );
+}
+
 /* create a keyed event */
 DECL_HANDLER(create_keyed_event)
 {
@@ -100,6 +100,7 @@
 #include "winternl.h"
 #include "winioctl.h"
 #include "ddk/wdm.h"
+#include "wine/rbtree.h"
 
 #if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
 # include <sys/epoll.h>
@@ -365,14 +366,35 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct rb_entry       rb_entry;   /* entry in sorted timeout tree */
+    struct list           entry;      /* entry in expired list */
+    struct rb_tree       *tree;       /* tree containing the timeout, NULL once expired */
     abstime_t             when;       /* timeout expiry */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+/* timeouts expiring at the same time are ordered by address, so that keys are unique */
+static int compare_timeout_users( const struct timeout_user *a, const struct timeout_user *b )
+{
+    if (a->when != b->when) return a->when < b->when ? -1 : 1;
+    if (a != b) return a < b ? -1 : 1;
+    return 0;
+}
+
+static int compare_abs_timeout( const void *key, const struct rb_entry *entry )
+{
+    return compare_timeout_users( key, RB_ENTRY_VALUE( entry, struct timeout_user, rb_entry ));
+}
+
+/* relative timeouts are stored as negative monotonic times */
+static int compare_rel_timeout( const void *key, const struct rb_entry *entry )
+{
+    return -compare_timeout_users( key, RB_ENTRY_VALUE( entry, struct timeout_user, rb_entry ));
+}
+
+static struct rb_tree abs_timeout_tree = { compare_abs_timeout }; /* sorted absolute timeouts */
+static struct rb_tree rel_timeout_tree = { compare_rel_timeout }; /* sorted relative timeouts */
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -453,42 +475,40 @@ void set_current_time(void)
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
     user->callback = func;
     user->private  = private;
+    user->tree     = user->when > 0 ? &abs_timeout_tree : &rel_timeout_tree;
 
-    /* Now insert it in the linked list */
-
-    if (user->when > 0)
-    {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
-    {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
-        }
-    }
-    list_add_before( ptr, &user->entry );
+    rb_put( user->tree, user, &user->rb_entry );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->tree) rb_remove( user->tree, &user->rb_entry );
+    else list_remove( &user->entry );
     free( user );
 }
 
+/* get the first timeout to expire in a tree */
+static struct timeout_user *get_first_timeout( struct rb_tree *tree )
+{
+    struct rb_entry *entry = rb_head( tree->root );
+    return entry ? RB_ENTRY_VALUE( entry, struct timeout_user, rb_entry ) : NULL;
+}
+
+/* move a timeout from its tree to the expired list */
+static void expire_timeout( struct timeout_user *timeout, struct list *expired_list )
+{
+    rb_remove( timeout->tree, &timeout->rb_entry );
+    timeout->tree = NULL;
+    list_add_tail( expired_list, &timeout->entry );
+}
+
 /* return a text description of a timeout for debugging purposes */
 const char *get_timeout_str( timeout_t timeout )
 {
@@ -920,58 +940,39 @@ static int get_next_timeout(void)
 {
     int ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeout_tree.root || rel_timeout_tree.root)
     {
         struct list expired_list, *ptr;
+        struct timeout_user *timeout;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the trees */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
-        }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
-        }
+        while ((timeout = get_first_timeout( &abs_timeout_tree )) && timeout->when <= current_time)
+            expire_timeout( timeout, &expired_list );
+        while ((timeout = get_first_timeout( &rel_timeout_tree )) && -timeout->when <= monotonic_time)
+            expire_timeout( timeout, &expired_list );
 
         /* now call the callback for all the removed timers */
 
         while ((ptr = list_head( &expired_list )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             list_remove( &timeout->entry );
             timeout->callback( timeout->private );
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if ((timeout = get_first_timeout( &abs_timeout_tree )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             timeout_t diff = (timeout->when - current_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if ((timeout = get_first_timeout( &rel_timeout_tree )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             timeout_t diff = (-timeout->when - monotonic_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
@@ -2839,7 +2840,7 @@ DECL_HANDLER(write)
 
     if (!fd) return;
 
-    if ((async = create_request_async( fd, fd->comp_flags, &req->async )))
+    if ((async = create_request_async_steal_data( fd, fd->comp_flags, &req->async )))
     {
         fd->fd_ops->write( fd, async, req->pos );
         reply->wait = async_handoff( async, &reply->size, 0 );
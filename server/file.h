@@ -135,6 +135,7 @@ struct timeout_user;
 extern timeout_t current_time;
 extern timeout_t monotonic_time;
 extern struct _KUSER_SHARED_DATA *user_shared_data;
+extern volatile unsigned int *queue_status_data;
 
 #define TICKS_PER_SEC 10000000
 
@@ -184,6 +185,8 @@ extern struct mapping *create_fd_mapping( struct object *root, const struct unic
                                           unsigned int attr, const struct security_descriptor *sd );
 extern struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                                 unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_queue_status_mapping( struct object *root, const struct unicode_str *name,
+                                                   unsigned int attr, const struct security_descriptor *sd );
 
 /* device functions */
 
@@ -223,6 +226,7 @@ typedef void (*async_completion_callback)( void *private );
 extern void free_async_queue( struct async_queue *queue );
 extern struct async *create_async( struct fd *fd, struct thread *thread, const async_data_t *data, struct iosb *iosb );
 extern struct async *create_request_async( struct fd *fd, unsigned int comp_flags, const async_data_t *data );
+extern struct async *create_request_async_steal_data( struct fd *fd, unsigned int comp_flags, const async_data_t *data );
 extern obj_handle_t async_handoff( struct async *async, data_size_t *result, int force_blocking );
 extern void queue_async( struct async_queue *queue, struct async *async );
 extern void async_set_timeout( struct async *async, timeout_t timeout, unsigned int status );
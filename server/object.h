@@ -214,6 +214,8 @@ extern struct event *get_event_obj( struct process *process, obj_handle_t handle
 extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern int inproc_sync_enabled(void);
+extern void release_inproc_sync_signal( struct object *obj );
 
 /* mutex functions */
 
@@ -142,6 +142,7 @@ struct msg_queue
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
     int                    keystate_lock;   /* owns an input keystate lock */
+    unsigned int           status_index;    /* index in the shared status data */
 };
 
 struct hotkey
@@ -279,6 +280,43 @@ static struct thread_input *create_thread_input( struct thread *thread )
     return input;
 }
 
+/* queue status bits shared with the clients, so that they can check them without a server call */
+volatile unsigned int *queue_status_data = NULL;
+static unsigned int queue_status_used;       /* number of entries ever allocated */
+static unsigned int *queue_status_free;      /* stack of released entries */
+static unsigned int queue_status_free_count;
+static unsigned int queue_status_free_size;
+
+static unsigned int alloc_queue_status_index(void)
+{
+    if (!queue_status_data) return ~0u;
+    if (queue_status_free_count) return queue_status_free[--queue_status_free_count];
+    if (queue_status_used < QUEUE_STATUS_ENTRIES) return queue_status_used++;
+    return ~0u;
+}
+
+static void free_queue_status_index( unsigned int index )
+{
+    if (index == ~0u) return;
+    queue_status_data[index] = 0;
+    if (queue_status_free_count == queue_status_free_size)
+    {
+        unsigned int new_size = max( 64, queue_status_free_size * 2 );
+        unsigned int *new_free = realloc( queue_status_free, new_size * sizeof(*new_free) );
+        if (!new_free) return;  /* leak the entry */
+        queue_status_free = new_free;
+        queue_status_free_size = new_size;
+    }
+    queue_status_free[queue_status_free_count++] = index;
+}
+
+/* publish the queue bits to the client */
+static inline void update_queue_status( struct msg_queue *queue )
+{
+    if (queue->status_index == ~0u) return;
+    queue_status_data[queue->status_index] = (queue->changed_bits << 16) | (queue->wake_bits & 0xffff);
+}
+
 /* create a message queue object */
 static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_input *input )
 {
@@ -310,6 +348,8 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
         queue->keystate_lock   = 0;
+        queue->status_index    = alloc_queue_status_index();
+        update_queue_status( queue );
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -537,6 +577,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
     }
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_status( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -545,6 +586,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_status( queue );
     if (!(queue->wake_bits & (QS_KEY | QS_MOUSEBUTTON)))
     {
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
@@ -1125,6 +1167,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    free_queue_status_index( queue->status_index );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -2455,7 +2498,12 @@ DECL_HANDLER(get_msg_queue)
     struct msg_queue *queue = get_current_queue();
 
     reply->handle = 0;
-    if (queue) reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+    reply->status_index = ~0u;
+    if (queue)
+    {
+        reply->handle = alloc_handle( current->process, queue, SYNCHRONIZE, 0 );
+        reply->status_index = queue->status_index;
+    }
 }
 
 
@@ -2514,6 +2562,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_status( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2694,6 +2743,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_status( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
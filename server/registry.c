@@ -33,6 +33,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -81,10 +82,12 @@ struct key
     WCHAR            *class;       /* key class */
     data_size_t       classlen;    /* length of class name */
     int               last_subkey; /* last in use subkey */
+    int               sorted_subkeys; /* count of subkeys in the sorted head of the array */
     int               nb_subkeys;  /* count of allocated subkeys */
     struct key      **subkeys;     /* subkeys array */
     struct key       *wow6432node; /* Wow6432Node subkey */
     int               last_value;  /* last in use value */
+    int               sorted_values; /* count of values in the sorted head of the array */
     int               nb_values;   /* count of allocated values in array */
     struct key_value *values;      /* values array */
     unsigned int      flags;       /* flags */
@@ -131,13 +134,17 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index );
+static int sort_values( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    int          cache_valid;  /* binary cache matches the saved file */
+    int          stamped;      /* text_st is valid */
+    struct stat  text_st;      /* stat of the text file when it was last loaded or saved */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -285,20 +292,97 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
-/* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+/*
+ * The subkeys and values arrays are made of two sorted runs: a sorted head, and a
+ * short tail where new entries are inserted, so that building a large key doesn't
+ * move the whole array on every insertion. The tail is merged into the head once it
+ * grows beyond the square root of the array size, or when the entries have to be
+ * accessed in order.
+ */
+
+static inline int compare_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
 {
-    int i, min, max, res;
-    data_size_t len;
+    int res = memicmp_strW( name1, name2, min( len1, len2 ) );
+    if (!res) res = len1 - len2;
+    return res;
+}
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(struct key * const *)p1;
+    const struct key *key2 = *(struct key * const *)p2;
+    return compare_names( key1->obj.name->name, key1->obj.name->len,
+                          key2->obj.name->name, key2->obj.name->len );
+}
+
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1;
+    const struct key_value *value2 = p2;
+    return compare_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* check whether the unsorted tail of an array should be merged into its head */
+static inline int tail_too_long( int sorted, int count )
+{
+    int tail = count - sorted;
+    return tail > 16 && tail > count / tail;
+}
+
+/* merge the tail of an array into its sorted head; return 1 if OK, 0 on error */
+static int merge_sorted_runs( void *array, size_t size, int sorted, int count,
+                              int (*compare)( const void *, const void * ) )
+{
+    char *base = array, *tmp, *head, *tail, *out;
+    size_t tail_size = (count - sorted) * size;
+
+    if (!sorted || sorted == count) return 1;
+    head = base + (sorted - 1) * size;
+    if (compare( head, head + size ) < 0) return 1;  /* already in order */
+    if (!(tmp = mem_alloc( tail_size ))) return 0;
+    memcpy( tmp, base + sorted * size, tail_size );
+
+    /* merge from the end, so that only the tail needs to be copied */
+    tail = tmp + tail_size - size;
+    out = base + (count - 1) * size;
+    while (tail >= tmp)
+    {
+        if (head >= base && compare( head, tail ) > 0)
+        {
+            memcpy( out, head, size );
+            head -= size;
+        }
+        else
+        {
+            memcpy( out, tail, size );
+            tail -= size;
+        }
+        out -= size;
+    }
+    free( tmp );
+    return 1;
+}
+
+/* make sure that the subkeys array is entirely sorted */
+static int sort_subkeys( struct key *key )
+{
+    if (!merge_sorted_runs( key->subkeys, sizeof(*key->subkeys), key->sorted_subkeys,
+                            key->last_subkey + 1, compare_subkeys )) return 0;
+    key->sorted_subkeys = key->last_subkey + 1;
+    return 1;
+}
+
+/* binary search a name in a sorted run of the subkeys array */
+static struct key *search_subkeys( const struct key *key, const struct unicode_str *name,
+                                   int min, int max, int *index )
+{
+    int i, res;
 
-    min = 0;
-    max = key->last_subkey;
     while (min <= max)
     {
         i = (min + max) / 2;
-        len = min( key->subkeys[i]->obj.name->len, name->len );
-        res = memicmp_strW( key->subkeys[i]->obj.name->name, name->str, len );
-        if (!res) res = key->subkeys[i]->obj.name->len - name->len;
+        res = compare_names( key->subkeys[i]->obj.name->name, key->subkeys[i]->obj.name->len,
+                             name->str, name->len );
         if (!res)
         {
             *index = i;
@@ -307,10 +391,45 @@ static struct key *find_subkey( const struct key *key, const struct unicode_str
         if (res > 0) max = i - 1;
         else min = i + 1;
     }
-    *index = min;  /* this is where we should insert it */
+    *index = min;
     return NULL;
 }
 
+/* find the named child of a given key and return its index */
+static struct key *find_subkey( struct key *key, const struct unicode_str *name, int *index )
+{
+    struct key *found;
+
+    if (tail_too_long( key->sorted_subkeys, key->last_subkey + 1 )) sort_subkeys( key );
+
+    if ((found = search_subkeys( key, name, 0, key->sorted_subkeys - 1, index ))) return found;
+    /* if not found, the index is where we should insert it in the tail */
+    return search_subkeys( key, name, key->sorted_subkeys, key->last_subkey, index );
+}
+
+/* remove a subkey from the array, without releasing it */
+static void remove_subkey( struct key *key, int index )
+{
+    memmove( key->subkeys + index, key->subkeys + index + 1,
+             (key->last_subkey - index) * sizeof(*key->subkeys) );
+    key->last_subkey--;
+    if (index < key->sorted_subkeys) key->sorted_subkeys--;
+}
+
+/* get the index of a subkey in the array */
+static int get_subkey_index( struct key *key, struct key *subkey )
+{
+    struct unicode_str name;
+    int i;
+
+    name.str = subkey->obj.name->name;
+    name.len = subkey->obj.name->len;
+    if (find_subkey( key, &name, &i ) == subkey) return i;
+    for (i = 0; i <= key->last_subkey; i++) if (key->subkeys[i] == subkey) break;
+    assert( i <= key->last_subkey );
+    return i;
+}
+
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
 static int grow_subkeys( struct key *key )
 {
@@ -337,11 +456,13 @@ static int grow_subkeys( struct key *key )
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -582,7 +703,7 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     struct key *key = (struct key *)obj;
     struct key *parent_key = (struct key *)parent;
     struct unicode_str tmp;
-    int i, index;
+    int index;
 
     if (parent->ops != &key_ops)
     {
@@ -601,8 +722,8 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     tmp.len = name->len;
     find_subkey( parent_key, &tmp, &index );
 
-    for (i = ++parent_key->last_subkey; i > index; i--)
-        parent_key->subkeys[i] = parent_key->subkeys[i - 1];
+    memmove( parent_key->subkeys + index + 1, parent_key->subkeys + index,
+             (++parent_key->last_subkey - index) * sizeof(*parent_key->subkeys) );
     parent_key->subkeys[index] = (struct key *)grab_object( key );
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
@@ -615,7 +736,7 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
 {
     struct key *key = (struct key *)obj;
     struct key *parent = (struct key *)name->parent;
-    int i, nb_subkeys;
+    int nb_subkeys;
 
     if (!parent) return;
 
@@ -625,10 +746,7 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
-    for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
-    parent->last_subkey--;
+    remove_subkey( parent, get_subkey_index( parent, key ));
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
     release_object( key );
@@ -701,11 +819,13 @@ static struct key *create_key_object( struct object *parent, const struct unicod
             key->classlen    = 0;
             key->flags       = 0;
             key->last_subkey = -1;
+            key->sorted_subkeys = 0;
             key->nb_subkeys  = 0;
             key->subkeys     = NULL;
             key->wow6432node = NULL;
             key->nb_values   = 0;
             key->last_value  = -1;
+            key->sorted_values = 0;
             key->values      = NULL;
             key->modif       = modif;
             list_init( &key->notify_list );
@@ -923,6 +1043,7 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        if (!sort_subkeys( key )) return;
         key = key->subkeys[index];
     }
 
@@ -1003,7 +1124,7 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     struct object_name *new_name_ptr;
     struct key *subkey, *parent = get_parent( key );
     data_size_t len;
-    int i, index, cur_index;
+    int index;
 
     /* changing to a path is not allowed */
     len = get_path_element( new_name->str, new_name->len );
@@ -1034,18 +1155,11 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     new_name_ptr->parent = &parent->obj;
     memcpy( new_name_ptr->name, new_name->str, new_name->len );
 
-    for (cur_index = 0; cur_index <= parent->last_subkey; cur_index++)
-        if (parent->subkeys[cur_index] == key) break;
-
-    if (cur_index < index && (index - cur_index) > 1)
-    {
-        --index;
-        for (i = cur_index; i < index; ++i) parent->subkeys[i] = parent->subkeys[i+1];
-    }
-    else if (cur_index > index)
-    {
-        for (i = cur_index; i > index; --i) parent->subkeys[i] = parent->subkeys[i-1];
-    }
+    /* move the key to its new position in the tail of the array */
+    remove_subkey( parent, get_subkey_index( parent, key ));
+    find_subkey( parent, new_name, &index );
+    memmove( parent->subkeys + index + 1, parent->subkeys + index,
+             (++parent->last_subkey - index) * sizeof(*parent->subkeys) );
     parent->subkeys[index] = key;
 
     free( key->obj.name );
@@ -1116,20 +1230,25 @@ static int grow_values( struct key *key )
     return 1;
 }
 
-/* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+/* make sure that the values array is entirely sorted */
+static int sort_values( struct key *key )
 {
-    int i, min, max, res;
-    data_size_t len;
+    if (!merge_sorted_runs( key->values, sizeof(*key->values), key->sorted_values,
+                            key->last_value + 1, compare_values )) return 0;
+    key->sorted_values = key->last_value + 1;
+    return 1;
+}
+
+/* binary search a name in a sorted run of the values array */
+static struct key_value *search_values( const struct key *key, const struct unicode_str *name,
+                                        int min, int max, int *index )
+{
+    int i, res;
 
-    min = 0;
-    max = key->last_value;
     while (min <= max)
     {
         i = (min + max) / 2;
-        len = min( key->values[i].namelen, name->len );
-        res = memicmp_strW( key->values[i].name, name->str, len );
-        if (!res) res = key->values[i].namelen - name->len;
+        res = compare_names( key->values[i].name, key->values[i].namelen, name->str, name->len );
         if (!res)
         {
             *index = i;
@@ -1138,16 +1257,27 @@ static struct key_value *find_value( const struct key *key, const struct unicode
         if (res > 0) max = i - 1;
         else min = i + 1;
     }
-    *index = min;  /* this is where we should insert it */
+    *index = min;
     return NULL;
 }
 
+/* find the named value of a given key and return its index in the array */
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index )
+{
+    struct key_value *found;
+
+    if (tail_too_long( key->sorted_values, key->last_value + 1 )) sort_values( key );
+
+    if ((found = search_values( key, name, 0, key->sorted_values - 1, index ))) return found;
+    /* if not found, the index is where we should insert it in the tail */
+    return search_values( key, name, key->sorted_values, key->last_value, index );
+}
+
 /* insert a new value; the index must have been returned by find_value */
 static struct key_value *insert_value( struct key *key, const struct unicode_str *name, int index )
 {
     struct key_value *value;
     WCHAR *new_name = NULL;
-    int i;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
@@ -1159,7 +1289,8 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
-    for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
+    memmove( key->values + index + 1, key->values + index,
+             (++key->last_value - index) * sizeof(*key->values) );
     value = &key->values[index];
     value->name    = new_name;
     value->namelen = name->len;
@@ -1260,7 +1391,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
     }
 
     if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
-    else
+    else if (sort_values( key ))
     {
         void *data;
         data_size_t namelen, maxlen;
@@ -1309,7 +1440,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    int i, index, nb_values;
+    int index, nb_values;
 
     if (key->flags & KEY_PREDEF)
     {
@@ -1325,8 +1456,10 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     if (debug_level > 1) dump_operation( key, value, "Delete" );
     free( value->name );
     free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
+    memmove( key->values + index, key->values + index + 1,
+             (key->last_value - index) * sizeof(*key->values) );
     key->last_value--;
+    if (index < key->sorted_values) key->sorted_values--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1805,13 +1938,230 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/*
+ * The binary registry cache is a snapshot of a branch written next to its text file
+ * when the server exits. It is only used when the text file hasn't been modified
+ * since the snapshot was taken, and lets us load the branch without parsing it.
+ * The data is in native byte order, every record is aligned to 4 bytes, and keys
+ * are stored depth-first: the key record, its name and class, its values, then its
+ * subkeys.
+ */
+
+#define REG_CACHE_MAGIC   0x47455257  /* 'WREG' */
+#define REG_CACHE_VERSION 1
+
+struct reg_cache_header
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int prefix_type;
+    unsigned int text_mtime[2];  /* modification time of the text file */
+    unsigned int text_size[2];   /* size of the text file */
+    unsigned int text_ino[2];    /* inode of the text file */
+};
+
+struct reg_cache_key
+{
+    unsigned int modif[2];       /* modification time */
+    unsigned int flags;          /* KEY_SYMLINK */
+    unsigned int namelen;        /* length of key name, ignored for the branch root */
+    unsigned int classlen;       /* length of class name */
+    unsigned int nb_values;      /* number of values */
+    unsigned int nb_subkeys;     /* number of subkeys */
+};
+
+struct reg_cache_value
+{
+    unsigned int type;           /* value type */
+    unsigned int namelen;        /* length of value name */
+    unsigned int len;            /* length of value data */
+};
+
+#define REG_CACHE_ALIGN(len) (((len) + 3) & ~3)
+
+/* information about a cache file being loaded */
+struct cache_load_info
+{
+    struct key *base;            /* key corresponding to the root of the branch */
+    const char *ptr;             /* current position */
+    const char *end;             /* end of the mapping */
+};
+
+static inline void split_uint64( unsigned int dst[2], unsigned __int64 val )
+{
+    dst[0] = (unsigned int)val;
+    dst[1] = (unsigned int)(val >> 32);
+}
+
+static inline unsigned __int64 join_uint64( const unsigned int src[2] )
+{
+    return ((unsigned __int64)src[1] << 32) | src[0];
+}
+
+/* fill the cache header with the stamp of the text file */
+static void get_reg_cache_stamp( const struct stat *st, struct reg_cache_header *header )
+{
+    timeout_t mtime = (timeout_t)st->st_mtime * TICKS_PER_SEC;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime += st->st_mtim.tv_nsec / 100;
+#endif
+    split_uint64( header->text_mtime, mtime );
+    split_uint64( header->text_size, st->st_size );
+    split_uint64( header->text_ino, st->st_ino );
+}
+
+/* check whether two cache headers have the same text file stamp */
+static int same_reg_cache_stamp( const struct reg_cache_header *a, const struct reg_cache_header *b )
+{
+    return !memcmp( a->text_mtime, b->text_mtime, sizeof(a->text_mtime) ) &&
+           !memcmp( a->text_size, b->text_size, sizeof(a->text_size) ) &&
+           !memcmp( a->text_ino, b->text_ino, sizeof(a->text_ino) );
+}
+
+/* return the name of the cache file for a given text file */
+static char *get_reg_cache_path( const char *filename )
+{
+    char *path;
+
+    if ((path = malloc( strlen(filename) + sizeof(".bin") )))
+    {
+        strcpy( path, filename );
+        strcat( path, ".bin" );
+    }
+    return path;
+}
+
+/* get the next chunk of the cache file, checking for overflows */
+static const void *get_cache_data( struct cache_load_info *info, data_size_t size )
+{
+    const void *ret = info->ptr;
+
+    if (REG_CACHE_ALIGN( (size_t)size ) > info->end - info->ptr) return NULL;
+    info->ptr += REG_CACHE_ALIGN( (size_t)size );
+    return ret;
+}
+
+/* load a key and its subkeys from the cache file */
+static int load_cache_key( struct key *parent, struct cache_load_info *info, int depth )
+{
+    const struct reg_cache_key *rec;
+    const struct reg_cache_value *val;
+    const WCHAR *class;
+    const void *data;
+    struct key_value *value;
+    struct unicode_str name;
+    struct key *key;
+    unsigned int i;
+    int index, ret = 0;
+
+    if (depth > 512) return 0;  /* don't recurse forever on a corrupted file */
+    if (!(rec = get_cache_data( info, sizeof(*rec) ))) return 0;
+    if (rec->namelen > MAX_NAME_LEN * sizeof(WCHAR)) return 0;
+    if (!(name.str = get_cache_data( info, rec->namelen ))) return 0;
+    name.len = rec->namelen;
+    if (!(class = get_cache_data( info, rec->classlen ))) return 0;
+
+    if (!parent) key = (struct key *)grab_object( info->base );
+    else if (!name.len) return 0;
+    else if (!(key = create_key_object( &parent->obj, &name, OBJ_OPENIF, 0, 0, NULL ))) return 0;
+
+    key->modif = join_uint64( rec->modif );
+    if (rec->flags & KEY_SYMLINK) key->flags |= KEY_SYMLINK;
+    if (rec->classlen)
+    {
+        free( key->class );
+        key->classlen = 0;
+        if (!(key->class = memdup( class, rec->classlen ))) goto done;
+        key->classlen = rec->classlen;
+    }
+
+    for (i = 0; i < rec->nb_values; i++)
+    {
+        if (!(val = get_cache_data( info, sizeof(*val) ))) goto done;
+        if (val->namelen > MAX_VALUE_LEN * sizeof(WCHAR)) goto done;
+        if (!(name.str = get_cache_data( info, val->namelen ))) goto done;
+        name.len = val->namelen;
+        if (!(data = get_cache_data( info, val->len ))) goto done;
+
+        if (!(value = find_value( key, &name, &index )) &&
+            !(value = insert_value( key, &name, index ))) goto done;
+        free( value->data );
+        value->data = val->len ? memdup( data, val->len ) : NULL;
+        value->len  = value->data ? val->len : 0;
+        value->type = val->type;
+    }
+
+    for (i = 0; i < rec->nb_subkeys; i++)
+        if (!load_cache_key( key, info, depth + 1 )) goto done;
+    ret = 1;
+
+done:
+    release_object( key );
+    return ret;
+}
+
+/* load a registry branch from its binary cache if the cache matches the text file */
+static int load_registry_cache( const char *filename, struct key *key, struct stat *text_st )
+{
+    const struct reg_cache_header *header;
+    struct reg_cache_header stamp;
+    struct cache_load_info info;
+    struct stat st;
+    size_t size;
+    char *path;
+    void *ptr;
+    int fd, ret = 0;
+
+    if (stat( filename, text_st ) == -1) return 0;
+    get_reg_cache_stamp( text_st, &stamp );
+
+    if (!(path = get_reg_cache_path( filename ))) return 0;
+    fd = open( path, O_RDONLY );
+    free( path );
+    if (fd == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header))
+    {
+        close( fd );
+        return 0;
+    }
+    size = st.st_size;
+    ptr = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return 0;
+
+    header = ptr;
+    if (header->magic == REG_CACHE_MAGIC && header->version == REG_CACHE_VERSION &&
+        same_reg_cache_stamp( header, &stamp ) &&
+        (header->prefix_type == PREFIX_32BIT || header->prefix_type == PREFIX_64BIT) &&
+        (prefix_type == PREFIX_UNKNOWN || header->prefix_type == prefix_type))
+    {
+        info.base = key;
+        info.ptr  = (const char *)(header + 1);
+        info.end  = (const char *)ptr + size;
+        if ((ret = load_cache_key( NULL, &info, 0 )))
+        {
+            /* the branch contents match the text file, no need to save it again */
+            prefix_type = header->prefix_type;
+            make_clean( key );
+        }
+        else if (debug_level)
+            fprintf( stderr, "%s: corrupted registry cache, loading the text file\n", filename );
+    }
+    munmap( ptr, size );
+    return ret;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    struct stat st;
+    int cache_valid = 0, stamped = 0, ret = 1;
+    FILE *f = NULL;
 
-    if ((f = fopen( filename, "r" )))
+    if (!(cache_valid = load_registry_cache( filename, key, &st )) && (f = fopen( filename, "r" )))
     {
+        /* stat before reading, so that a concurrent change invalidates the stamp */
+        stamped = !fstat( fileno( f ), &st );
         load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
@@ -1820,13 +2170,18 @@ static int load_init_registry_from_file( const char *filename, struct key *key )
             return 1;
         }
     }
+    else if (!cache_valid) ret = 0;
+    else stamped = 1;
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
     save_branch_info[save_branch_count].path = filename;
+    save_branch_info[save_branch_count].cache_valid = cache_valid;
+    save_branch_info[save_branch_count].stamped = stamped;
+    if (stamped) save_branch_info[save_branch_count].text_st = st;
     save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+    return ret;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -2047,8 +2402,10 @@ static void save_registry( struct key *key, obj_handle_t handle )
 }
 
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+static int save_branch( struct save_branch_info *info )
 {
+    struct key *key = info->key;
+    const char *path = info->path;
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
@@ -2116,7 +2473,101 @@ static int save_branch( struct key *key, const char *path )
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
+    if (ret)
+    {
+        make_clean( key );
+        info->stamped = !stat( path, &info->text_st );
+    }
+    return ret;
+}
+
+/* write a chunk of the cache file, padded to the record alignment */
+static void write_cache_data( const void *data, size_t size, FILE *f )
+{
+    static const char padding[3];
+
+    fwrite( data, 1, size, f );
+    fwrite( padding, 1, REG_CACHE_ALIGN( size ) - size, f );
+}
+
+/* save a key and its non-volatile subkeys to the cache file */
+static void save_cache_key( struct key *key, const struct key *base, FILE *f )
+{
+    struct reg_cache_key rec;
+    struct reg_cache_value val;
+    int i;
+
+    sort_subkeys( key );
+    sort_values( key );
+    split_uint64( rec.modif, key->modif );
+    rec.flags      = key->flags & KEY_SYMLINK;
+    rec.namelen    = key == base ? 0 : key->obj.name->len;
+    rec.classlen   = key->classlen;
+    rec.nb_values  = key->last_value + 1;
+    rec.nb_subkeys = 0;
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!(key->subkeys[i]->flags & KEY_VOLATILE)) rec.nb_subkeys++;
+
+    write_cache_data( &rec, sizeof(rec), f );
+    write_cache_data( key->obj.name->name, rec.namelen, f );
+    write_cache_data( key->class, rec.classlen, f );
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        val.type    = key->values[i].type;
+        val.namelen = key->values[i].namelen;
+        val.len     = key->values[i].len;
+        write_cache_data( &val, sizeof(val), f );
+        write_cache_data( key->values[i].name, val.namelen, f );
+        write_cache_data( key->values[i].data, val.len, f );
+    }
+
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!(key->subkeys[i]->flags & KEY_VOLATILE)) save_cache_key( key->subkeys[i], base, f );
+}
+
+/* save the binary cache of a registry branch, if the text file still matches the branch contents */
+static int save_registry_cache( struct save_branch_info *info )
+{
+    struct reg_cache_header header, stamp;
+    struct stat st;
+    char *path, *tmp;
+    int fd, ret = 0;
+    FILE *f;
+
+    /* the text file may have been modified behind our back since we loaded or saved it */
+    if (!info->stamped) return 0;
+    if (stat( info->path, &st ) == -1 || !S_ISREG(st.st_mode)) return 0;
+    get_reg_cache_stamp( &info->text_st, &header );
+    get_reg_cache_stamp( &st, &stamp );
+    if (!same_reg_cache_stamp( &header, &stamp )) return 0;
+    if (!(path = get_reg_cache_path( info->path ))) return 0;
+    if (!(tmp = malloc( strlen(path) + sizeof(".tmp") ))) goto done;
+    strcpy( tmp, path );
+    strcat( tmp, ".tmp" );
+
+    if ((fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1) goto done;
+    if (!(f = fdopen( fd, "w" )))
+    {
+        close( fd );
+        unlink( tmp );
+        goto done;
+    }
+
+    header.magic       = REG_CACHE_MAGIC;
+    header.version     = REG_CACHE_VERSION;
+    header.prefix_type = prefix_type;
+    write_cache_data( &header, sizeof(header), f );
+    save_cache_key( info->key, info->key, f );
+
+    ret = !fclose( f );
+    if (ret) ret = !rename( tmp, path );
+    if (!ret) unlink( tmp );
+
+done:
+    free( tmp );
+    free( path );
+    info->cache_valid = ret;
     return ret;
 }
 
@@ -2128,7 +2579,10 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+    {
+        if (save_branch_info[i].key->flags & KEY_DIRTY) save_branch_info[i].cache_valid = 0;
+        save_branch( &save_branch_info[i] );
+    }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2148,12 +2602,14 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (save_branch_info[i].key->flags & KEY_DIRTY) save_branch_info[i].cache_valid = 0;
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
             perror( " " );
         }
+        else if (!save_branch_info[i].cache_valid) save_registry_cache( &save_branch_info[i] );
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 }
@@ -128,6 +128,8 @@ int config_dir_fd = -1;    /* file descriptor for the config dir */
 static struct master_socket *master_socket;  /* the master socket object */
 static struct timeout_user *master_timeout;
 
+static void *request_buffer;  /* spare buffer for the request data */
+
 /* complain about a protocol error and terminate the client connection */
 void fatal_protocol_error( struct thread *thread, const char *err, ... )
 {
@@ -327,24 +329,56 @@ static void call_req_handler( struct thread *thread )
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
+    struct iovec vec[2];
     int ret;
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
+        if (!request_buffer) request_buffer = malloc( REQUEST_BUFFER_SIZE );
+
+        /* the client waits for the reply before sending another request,
+         * so we can't read past the end of the current one */
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = request_buffer;
+        vec[1].iov_len  = REQUEST_BUFFER_SIZE;
+
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, request_buffer ? 2 : 1 )) <
+            (int)sizeof(thread->req)) goto error;
+        ret -= sizeof(thread->req);
+
+        if (ret > thread->req.request_header.request_size)
+        {
+            fatal_protocol_error( thread, "too much data %d for request %d\n",
+                                  ret, thread->req.request_header.req );
+            return;
+        }
         if (!(thread->req_toread = thread->req.request_header.request_size))
         {
             /* no data, handle request at once */
             call_req_handler( thread );
             return;
         }
+        if (ret == thread->req_toread)
+        {
+            /* got all the data already, lend the buffer to the thread */
+            thread->req_data = request_buffer;
+            thread->req_toread = 0;
+            request_buffer = NULL;
+            call_req_handler( thread );
+            /* the buffer has been freed if the thread was killed */
+            request_buffer = thread->req_data;
+            thread->req_data = NULL;
+            return;
+        }
         if (!(thread->req_data = malloc( thread->req_toread )))
         {
             fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
                                   thread->req_toread, thread->req.request_header.req );
             return;
         }
+        memcpy( thread->req_data, request_buffer, ret );
+        thread->req_toread -= ret;
     }
 
     /* read the variable sized data */
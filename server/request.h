@@ -29,6 +29,9 @@
 /* max request length */
 #define MAX_REQUEST_LENGTH  8192
 
+/* most requests are small enough to be read in a single system call along with their header */
+#define REQUEST_BUFFER_SIZE 4096
+
 /* request handler definition */
 #define DECL_HANDLER(name) \
     void req_##name( const struct name##_request *req, struct name##_reply *reply )
@@ -84,6 +87,17 @@ static inline data_size_t get_req_data_size(void)
     return current->req.request_header.request_size;
 }
 
+/* take ownership of the request vararg data, or a copy of it for small requests; the caller has to free it */
+static inline void *steal_req_data(void)
+{
+    void *data = current->req_data;
+
+    /* small requests may be using the spare request buffer, which must not be kept */
+    if (get_req_data_size() <= REQUEST_BUFFER_SIZE) return memdup( data, get_req_data_size() );
+    current->req_data = NULL;
+    return data;
+}
+
 /* get the request vararg as unicode string */
 static inline struct unicode_str get_req_unicode_str(void)
 {
@@ -151,6 +165,8 @@ DECL_HANDLER(select);
 DECL_HANDLER(create_event);
 DECL_HANDLER(event_op);
 DECL_HANDLER(query_event);
+DECL_HANDLER(get_inproc_sync_fd);
+DECL_HANDLER(get_inproc_apc_fd);
 DECL_HANDLER(open_event);
 DECL_HANDLER(create_keyed_event);
 DECL_HANDLER(open_keyed_event);
@@ -373,6 +389,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -437,6 +454,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_create_event,
     (req_handler)req_event_op,
     (req_handler)req_query_event,
+    (req_handler)req_get_inproc_sync_fd,
+    (req_handler)req_get_inproc_apc_fd,
     (req_handler)req_open_event,
     (req_handler)req_create_keyed_event,
     (req_handler)req_open_keyed_event,
@@ -659,6 +678,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -927,6 +947,12 @@ C_ASSERT( sizeof(struct query_event_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_event_reply, manual_reset) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_event_reply, state) == 12 );
 C_ASSERT( sizeof(struct query_event_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_fd_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_inproc_sync_fd_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_fd_reply, type) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_fd_reply, access) == 12 );
+C_ASSERT( sizeof(struct get_inproc_sync_fd_reply) == 16 );
+C_ASSERT( sizeof(struct get_inproc_apc_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_event_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_event_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_event_request, rootdir) == 20 );
@@ -1321,6 +1347,7 @@ C_ASSERT( FIELD_OFFSET(struct get_atom_information_reply, total) == 16 );
 C_ASSERT( sizeof(struct get_atom_information_reply) == 24 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, status_index) == 12 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
@@ -2171,6 +2198,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -133,6 +133,19 @@ union unix_sockaddr
 
 static struct list poll_list = LIST_INIT( poll_list );
 
+struct poll_req;
+
+struct poll_socket_entry
+{
+    struct list entry;        /* entry in the socket poll list */
+    struct poll_req *req;     /* poll request containing this entry */
+    struct sock *sock;
+    int mask;
+    obj_handle_t handle;
+    int flags;
+    unsigned int status;
+};
+
 struct poll_req
 {
     struct list entry;
@@ -143,14 +156,7 @@ struct poll_req
     int exclusive;
     int pending;
     unsigned int count;
-    struct
-    {
-        struct sock *sock;
-        int mask;
-        obj_handle_t handle;
-        int flags;
-        unsigned int status;
-    } sockets[1];
+    struct poll_socket_entry sockets[1];
 };
 
 struct accept_req
@@ -237,6 +243,7 @@ struct sock
     struct accept_req  *accept_recv_req; /* pending accept-into request which will recv on this socket */
     struct connect_req *connect_req; /* pending connection request */
     struct poll_req    *main_poll;   /* main poll */
+    struct list         poll_list;   /* list of poll request entries waiting on this socket */
     union win_sockaddr  addr;        /* socket name */
     int                 addr_len;    /* socket name length */
     unsigned int        rcvbuf;      /* advisory recv buffer size */
@@ -1034,7 +1041,10 @@ static void free_poll_req( void *private )
     if (req->timeout) remove_timeout_user( req->timeout );
 
     for (i = 0; i < req->count; ++i)
+    {
+        list_remove( &req->sockets[i].entry );
         release_object( req->sockets[i].sock );
+    }
     release_object( req->async );
     release_object( req->iosb );
     list_remove( &req->entry );
@@ -1156,31 +1166,28 @@ static void complete_async_poll( struct poll_req *req, unsigned int status )
 static void complete_async_polls( struct sock *sock, int event, int error )
 {
     int flags = get_poll_flags( sock, event );
-    struct poll_req *req, *next;
+    struct poll_socket_entry *entry;
 
-    LIST_FOR_EACH_ENTRY_SAFE( req, next, &poll_list, struct poll_req, entry )
+restart:
+    LIST_FOR_EACH_ENTRY( entry, &sock->poll_list, struct poll_socket_entry, entry )
     {
-        unsigned int i;
+        struct poll_req *req = entry->req;
 
         if (req->iosb->status != STATUS_PENDING) continue;
+        if (!(entry->mask & flags)) continue;
 
-        for (i = 0; i < req->count; ++i)
-        {
-            if (req->sockets[i].sock != sock) continue;
-            if (!(req->sockets[i].mask & flags)) continue;
-
-            if (debug_level)
-                fprintf( stderr, "completing poll for socket %p, wanted %#x got %#x\n",
-                         sock, req->sockets[i].mask, flags );
+        if (debug_level)
+            fprintf( stderr, "completing poll for socket %p, wanted %#x got %#x\n",
+                     sock, entry->mask, flags );
 
-            req->sockets[i].flags = req->sockets[i].mask & flags;
-            req->sockets[i].status = sock_get_ntstatus( error );
+        entry->flags = entry->mask & flags;
+        entry->status = sock_get_ntstatus( error );
 
-            if (req->pending)
-            {
-                complete_async_poll( req, STATUS_SUCCESS );
-                break;
-            }
+        if (req->pending)
+        {
+            /* completing the request may free it along with its other entries in our list */
+            complete_async_poll( req, STATUS_SUCCESS );
+            goto restart;
         }
     }
 }
@@ -1457,7 +1464,7 @@ static int sock_get_poll_events( struct fd *fd )
 {
     struct sock *sock = get_fd_user( fd );
     unsigned int mask = sock->mask & ~sock->reported_events;
-    struct poll_req *req;
+    struct poll_socket_entry *entry;
     int ev = 0;
 
     assert( sock->obj.ops == &sock_ops );
@@ -1465,17 +1472,8 @@ static int sock_get_poll_events( struct fd *fd )
     if (!sock->type) /* not initialized yet */
         return -1;
 
-    LIST_FOR_EACH_ENTRY( req, &poll_list, struct poll_req, entry )
-    {
-        unsigned int i;
-
-        for (i = 0; i < req->count; ++i)
-        {
-            if (req->sockets[i].sock != sock) continue;
-
-            ev |= poll_flags_from_afd( sock, req->sockets[i].mask );
-        }
-    }
+    LIST_FOR_EACH_ENTRY( entry, &sock->poll_list, struct poll_socket_entry, entry )
+        ev |= poll_flags_from_afd( sock, entry->mask );
 
     switch (sock->state)
     {
@@ -1624,7 +1622,7 @@ static int sock_close_handle( struct object *obj, struct process *process, obj_h
     if (sock->obj.handle_count == 1) /* last handle */
     {
         struct accept_req *accept_req, *accept_next;
-        struct poll_req *poll_req, *poll_next;
+        struct poll_socket_entry *entry;
 
         if (sock->accept_recv_req)
             async_terminate( sock->accept_recv_req->async, STATUS_CANCELLED );
@@ -1635,25 +1633,20 @@ static int sock_close_handle( struct object *obj, struct process *process, obj_h
         if (sock->connect_req)
             async_terminate( sock->connect_req->async, STATUS_CANCELLED );
 
-        LIST_FOR_EACH_ENTRY_SAFE( poll_req, poll_next, &poll_list, struct poll_req, entry )
+        LIST_FOR_EACH_ENTRY( entry, &sock->poll_list, struct poll_socket_entry, entry )
         {
-            struct iosb *iosb = poll_req->iosb;
-            BOOL signaled = FALSE;
-            unsigned int i;
-
-            if (iosb->status != STATUS_PENDING) continue;
-
-            for (i = 0; i < poll_req->count; ++i)
-            {
-                if (poll_req->sockets[i].sock == sock)
-                {
-                    signaled = TRUE;
-                    poll_req->sockets[i].flags = AFD_POLL_CLOSE;
-                    poll_req->sockets[i].status = 0;
-                }
-            }
+            if (entry->req->iosb->status != STATUS_PENDING) continue;
+            entry->flags = AFD_POLL_CLOSE;
+            entry->status = 0;
+        }
 
-            if (signaled) complete_async_poll( poll_req, STATUS_SUCCESS );
+    restart:
+        LIST_FOR_EACH_ENTRY( entry, &sock->poll_list, struct poll_socket_entry, entry )
+        {
+            if (entry->req->iosb->status != STATUS_PENDING) continue;
+            /* completing the request may free it along with its other entries in our list */
+            complete_async_poll( entry->req, STATUS_SUCCESS );
+            goto restart;
         }
     }
 
@@ -1742,6 +1735,7 @@ static struct sock *create_socket(void)
     init_async_queue( &sock->poll_q );
     memset( sock->errors, 0, sizeof(sock->errors) );
     list_init( &sock->accept_list );
+    list_init( &sock->poll_list );
     return sock;
 }
 
@@ -3375,8 +3369,10 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
                          unsigned int count, const struct afd_poll_socket_64 *sockets )
 {
     BOOL signaled = FALSE;
+    struct pollfd *pollfds;
     struct poll_req *req;
     unsigned int i, j;
+    int ret;
 
     if (!count)
     {
@@ -3384,14 +3380,21 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
         return;
     }
 
+    if (!(pollfds = mem_alloc( count * sizeof(*pollfds) )))
+        return;
+
     if (!(req = mem_alloc( offsetof( struct poll_req, sockets[count] ) )))
+    {
+        free( pollfds );
         return;
+    }
 
     req->timeout = NULL;
     req->pending = 0;
     if (timeout && timeout != TIMEOUT_INFINITE &&
         !(req->timeout = add_timeout_user( timeout, async_poll_timeout, req )))
     {
+        free( pollfds );
         free( req );
         return;
     }
@@ -3404,9 +3407,11 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
         {
             for (j = 0; j < i; ++j) release_object( req->sockets[j].sock );
             if (req->timeout) remove_timeout_user( req->timeout );
+            free( pollfds );
             free( req );
             return;
         }
+        req->sockets[i].req = req;
         req->sockets[i].handle = sockets[i].socket;
         req->sockets[i].mask = sockets[i].flags;
         req->sockets[i].flags = 0;
@@ -3420,19 +3425,29 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
     handle_exclusive_poll(req);
 
     list_add_tail( &poll_list, &req->entry );
+    for (i = 0; i < count; ++i)
+        list_add_tail( &req->sockets[i].sock->poll_list, &req->sockets[i].entry );
     async_set_completion_callback( async, free_poll_req, req );
     queue_async( &poll_sock->poll_q, async );
 
+    /* check the current state of all the sockets with a single poll() call */
+    for (i = 0; i < count; ++i)
+    {
+        struct sock *sock = req->sockets[i].sock;
+
+        pollfds[i].events = poll_flags_from_afd( sock, req->sockets[i].mask );
+        pollfds[i].fd = pollfds[i].events >= 0 ? get_unix_fd( sock->fd ) : -1;
+        pollfds[i].revents = 0;
+    }
+    ret = poll( pollfds, count, 0 );
+
     for (i = 0; i < count; ++i)
     {
         struct sock *sock = req->sockets[i].sock;
         int mask = req->sockets[i].mask;
-        struct pollfd pollfd;
 
-        pollfd.fd = get_unix_fd( sock->fd );
-        pollfd.events = poll_flags_from_afd( sock, mask );
-        if (pollfd.events >= 0 && poll( &pollfd, 1, 0 ) >= 0)
-            sock_poll_event( sock->fd, pollfd.revents );
+        if (ret >= 0 && pollfds[i].fd != -1)
+            sock_poll_event( sock->fd, pollfds[i].revents );
 
         /* FIXME: do other error conditions deserve a similar treatment? */
         if (sock->state != SOCK_CONNECTING && sock->errors[AFD_POLL_BIT_CONNECT_ERR] && (mask & AFD_POLL_CONNECT_ERR))
@@ -3452,6 +3467,7 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
 
     for (i = 0; i < req->count; ++i)
         sock_reselect( req->sockets[i].sock );
+    free( pollfds );
     set_error( STATUS_PENDING );
 }
 
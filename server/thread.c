@@ -32,6 +32,9 @@
 #include <unistd.h>
 #include <time.h>
 #include <poll.h>
+#ifdef HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
 #ifdef HAVE_SCHED_H
 /* FreeBSD needs this for cpu_set_t instead of its cpuset_t */
 #define _WITH_CPU_SET_T
@@ -238,6 +241,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->request_fd      = NULL;
     thread->reply_fd        = NULL;
     thread->wait_fd         = NULL;
+    thread->inproc_apc_fd   = NULL;
     thread->state           = RUNNING;
     thread->exit_code       = 0;
     thread->priority        = 0;
@@ -418,6 +422,7 @@ static void cleanup_thread( struct thread *thread )
     if (thread->request_fd) release_object( thread->request_fd );
     if (thread->reply_fd) release_object( thread->reply_fd );
     if (thread->wait_fd) release_object( thread->wait_fd );
+    if (thread->inproc_apc_fd) release_object( thread->inproc_apc_fd );
     cleanup_clipboard_thread(thread);
     destroy_thread_windows( thread );
     free_msg_queue( thread );
@@ -436,6 +441,7 @@ static void cleanup_thread( struct thread *thread )
     thread->request_fd = NULL;
     thread->reply_fd = NULL;
     thread->wait_fd = NULL;
+    thread->inproc_apc_fd = NULL;
     thread->desktop = 0;
     thread->desc = NULL;
     thread->desc_len = 0;
@@ -850,6 +856,8 @@ static int check_wait( struct thread *thread )
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             not_ok |= !entry->obj->ops->signaled( entry->obj, entry );
         if (!not_ok) return STATUS_WAIT_0;
+        for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+            release_inproc_sync_signal( entry->obj );
     }
     else
     {
@@ -1092,6 +1100,20 @@ static inline int is_in_apc_wait( struct thread *thread )
             (thread->wait && (thread->wait->flags & SELECT_INTERRUPTIBLE)));
 }
 
+/* update the eventfd that lets the client check for pending system APCs without a server call */
+static void update_inproc_apc_fd( struct thread *thread )
+{
+    uint64_t value = 1;
+    ssize_t ret;
+
+    if (!thread->inproc_apc_fd) return;
+    if (list_empty( &thread->system_apc ))
+        ret = read( get_unix_fd( thread->inproc_apc_fd ), &value, sizeof(value) );
+    else
+        ret = write( get_unix_fd( thread->inproc_apc_fd ), &value, sizeof(value) );
+    if (ret == -1 && errno != EAGAIN) perror( "wineserver: inproc apc fd" );
+}
+
 /* queue an existing APC to a given thread */
 static int queue_apc( struct process *process, struct thread *thread, struct thread_apc *apc )
 {
@@ -1144,6 +1166,7 @@ static int queue_apc( struct process *process, struct thread *thread, struct thr
 
     grab_object( apc );
     list_add_tail( queue, &apc->entry );
+    if (queue == &thread->system_apc) update_inproc_apc_fd( thread );
     if (!list_prev( queue, &apc->entry ))  /* first one */
         wake_thread( thread );
 
@@ -1174,6 +1197,7 @@ void thread_cancel_apc( struct thread *thread, struct object *owner, enum apc_ty
     {
         if (apc->owner != owner) continue;
         list_remove( &apc->entry );
+        if (queue == &thread->system_apc) update_inproc_apc_fd( thread );
         apc->executed = 1;
         wake_up( &apc->obj, 0 );
         release_object( apc );
@@ -1191,6 +1215,7 @@ static struct thread_apc *thread_dequeue_apc( struct thread *thread, int system
     {
         apc = LIST_ENTRY( ptr, struct thread_apc, entry );
         list_remove( ptr );
+        if (system) update_inproc_apc_fd( thread );
     }
     return apc;
 }
@@ -1822,6 +1847,34 @@ DECL_HANDLER(get_apc_result)
     release_object( apc );
 }
 
+/* retrieve the fd signaled while the current thread has pending system APCs */
+DECL_HANDLER(get_inproc_apc_fd)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    int unix_fd;
+
+    if (!current->inproc_apc_fd)
+    {
+        if (!inproc_sync_enabled())
+        {
+            set_error( STATUS_NOT_IMPLEMENTED );
+            return;
+        }
+        if ((unix_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK )) == -1)
+        {
+            file_set_error();
+            return;
+        }
+        if (!(current->inproc_apc_fd = create_anonymous_fd( &thread_fd_ops, unix_fd, &current->obj, 0 )))
+            return;
+        update_inproc_apc_fd( current );
+    }
+    send_client_fd( current->process, get_unix_fd( current->inproc_apc_fd ), 0 );
+#else
+    set_error( STATUS_NOT_IMPLEMENTED );
+#endif
+}
+
 /* retrieve the current context of a thread */
 DECL_HANDLER(get_thread_context)
 {
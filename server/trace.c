@@ -1379,6 +1379,25 @@ static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_completion_infos( const char *prefix, data_size_t size )
+{
+    const struct completion_info *info;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*info))
+    {
+        info = cur_data;
+        dump_uint64( "{ckey=", &info->ckey );
+        dump_uint64( ",cvalue=", &info->cvalue );
+        dump_uint64( ",information=", &info->information );
+        fprintf( stderr, ",status=%08x}", info->status );
+        size -= sizeof(*info);
+        remove_data( sizeof(*info) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 typedef void (*dump_func)( const void *req );
 
 /* Everything below this line is generated automatically by tools/make_requests */
@@ -1793,6 +1812,21 @@ static void dump_query_event_reply( const struct query_event_reply *req )
     fprintf( stderr, ", state=%d", req->state );
 }
 
+static void dump_get_inproc_sync_fd_request( const struct get_inproc_sync_fd_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_inproc_sync_fd_reply( const struct get_inproc_sync_fd_reply *req )
+{
+    fprintf( stderr, " type=%d", req->type );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_get_inproc_apc_fd_request( const struct get_inproc_apc_fd_request *req )
+{
+}
+
 static void dump_open_event_request( const struct open_event_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2627,6 +2661,7 @@ static void dump_get_msg_queue_request( const struct get_msg_queue_request *req
 static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", status_index=%08x", req->status_index );
 }
 
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
@@ -4322,6 +4357,16 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_remove_completions_request( const struct remove_completions_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_remove_completions_reply( const struct remove_completions_reply *req )
+{
+    dump_varargs_completion_infos( " info=", cur_size );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4584,6 +4629,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_event_request,
     (dump_func)dump_event_op_request,
     (dump_func)dump_query_event_request,
+    (dump_func)dump_get_inproc_sync_fd_request,
+    (dump_func)dump_get_inproc_apc_fd_request,
     (dump_func)dump_open_event_request,
     (dump_func)dump_create_keyed_event_request,
     (dump_func)dump_open_keyed_event_request,
@@ -4806,6 +4853,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_remove_completions_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
@@ -4867,6 +4915,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_create_event_reply,
     (dump_func)dump_event_op_reply,
     (dump_func)dump_query_event_reply,
+    (dump_func)dump_get_inproc_sync_fd_reply,
+    NULL,
     (dump_func)dump_open_event_reply,
     (dump_func)dump_create_keyed_event_reply,
     (dump_func)dump_open_keyed_event_reply,
@@ -5089,6 +5139,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_remove_completions_reply,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
@@ -5150,6 +5201,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "create_event",
     "event_op",
     "query_event",
+    "get_inproc_sync_fd",
+    "get_inproc_apc_fd",
     "open_event",
     "create_keyed_event",
     "open_keyed_event",
@@ -5372,6 +5425,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "remove_completions",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",